@@ -0,0 +1,68 @@
+#include "BinLog.h"
+
+#ifdef POSSUM_LOG
+BinLog binlog;
+#endif
+
+// Critical sections restore the caller's interrupt state instead of enabling
+// interrupts, so logging from code that has them off leaves them off
+static inline uint32_t disableInterrupts() {
+#ifdef __arm__
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask" : "=r"(primask));
+  __disable_irq();
+  return primask;
+#else
+  noInterrupts();
+  return 0;
+#endif
+}
+
+static inline void restoreInterrupts(uint32_t primask) {
+  if (!primask) {
+    interrupts();
+  }
+}
+
+void BinLog::write(uint8_t id, uint16_t a, uint16_t b, uint16_t c) {
+  uint32_t now = micros();
+  uint32_t primask = disableInterrupts();
+  uint8_t next = (head + 1) & (LOG_RING_SIZE - 1);
+  if (next == tail) {
+    // Full; keep the older records since they explain how we got here
+    dropped++;
+    restoreInterrupts(primask);
+    return;
+  }
+  LogRecord& r = records[head];
+  r.time = now;
+  r.id = id;
+  r.reserved = 0;
+  r.args[0] = a;
+  r.args[1] = b;
+  r.args[2] = c;
+  head = next;
+  restoreInterrupts(primask);
+}
+
+void BinLog::drain(Print& out) {
+  const int frameSize = 2 + sizeof(LogRecord);
+
+  if (dropped > 0 && out.availableForWrite() >= frameSize) {
+    uint32_t primask = disableInterrupts();
+    uint16_t n = dropped;
+    dropped = 0;
+    restoreInterrupts(primask);
+    LogRecord r = { micros(), LOG_DROPPED, 0, { n, 0, 0 } };
+    out.write(LOG_SYNC_1);
+    out.write(LOG_SYNC_2);
+    out.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r));
+  }
+
+  while (tail != head && out.availableForWrite() >= frameSize) {
+    out.write(LOG_SYNC_1);
+    out.write(LOG_SYNC_2);
+    out.write(reinterpret_cast<const uint8_t*>(&records[tail]), sizeof(LogRecord));
+    tail = (tail + 1) & (LOG_RING_SIZE - 1);
+  }
+}
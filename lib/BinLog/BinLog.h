@@ -0,0 +1,57 @@
+#ifndef _BINLOG_H_
+#define _BINLOG_H_
+
+#include <Arduino.h>
+
+// Diagnostics without the cost of formatting or blocking on USB serial.
+// LOG(id, args...) stores a fixed-size binary record in a RAM ring, which is
+// cheap enough for any code path. drain() sends records to Serial only while
+// there's room in its buffer, and tools/log_decode.py turns them back into
+// text using the formats in LogEvents.h.
+//
+// Compiled in with -D POSSUM_LOG; without it LOG() is a no-op.
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32 // Must be a power of two; each record is 12 bytes
+#endif
+
+// Every record goes out as LOG_SYNC_1 LOG_SYNC_2 <LogRecord>, so the decoder
+// can find record boundaries in a stream that also carries other output.
+#define LOG_SYNC_1 0xA5
+#define LOG_SYNC_2 0x5A
+
+enum LogEvent : uint8_t {
+  LOG_NONE = 0,
+#define LOG_EVENT(id, format) id,
+#include "LogEvents.h"
+#undef LOG_EVENT
+};
+
+struct LogRecord {
+  uint32_t time; // micros()
+  uint8_t id;
+  uint8_t reserved;
+  uint16_t args[3];
+};
+
+class BinLog {
+  public:
+    void write(uint8_t id, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0);
+    // Sends as many waiting records as Serial can take without blocking
+    void drain(Print& out);
+
+  private:
+    LogRecord records[LOG_RING_SIZE];
+    volatile uint8_t head = 0; // next write
+    volatile uint8_t tail = 0; // next to send
+    volatile uint16_t dropped = 0;
+};
+
+#ifdef POSSUM_LOG
+extern BinLog binlog;
+#define LOG(...) binlog.write(__VA_ARGS__)
+#else
+#define LOG(...) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+// Log event ids and how tools/log_decode.py prints them. Ids are assigned in
+// order from 1, so only ever add to the end of the list.
+//
+// LOG_EVENT(id, format)   format: printf style, one conversion per argument
+LOG_EVENT(LOG_DROPPED, "%u log records dropped (ring full)")
+LOG_EVENT(LOG_BOOT, "boot, %u bytes free")
+LOG_EVENT(LOG_INIT_DONE, "init complete, %u panel(s), %u bytes free")
+LOG_EVENT(LOG_PANEL_FOUND, "panel %u: LED drivers at 0x%02x, 0x%02x")
+LOG_EVENT(LOG_SLOW_LOOP, "slow loop: %u us")
+LOG_EVENT(LOG_I2C_ERROR, "I2C error %u writing to 0x%02x")
+LOG_EVENT(LOG_PCA_INIT, "PCA9956 0x%02x init, PWM %u")
+LOG_EVENT(LOG_PCA_LEDOUT, "PCA9956 0x%02x LEDOUT reg 0x%02x = 0x%02x")
+LOG_EVENT(LOG_PCA_ON, "PCA9956 0x%02x LED %u on")
+LOG_EVENT(LOG_PCA_OFF, "PCA9956 0x%02x LED %u off")
+LOG_EVENT(LOG_PCA_PATTERN, "PCA9956 0x%02x pattern, LED0 = %u")
+LOG_EVENT(LOG_PANEL_NO_RAM, "panel %u skipped, only %u bytes free")
@@ -22,7 +22,6 @@
  */
 
 #include "PCA9956.h"
-// #define SERIAL_DEBUG
 
 // Init PCA9956 library with the pointer of TwoWire instance Wire or Wire1
 PCA9956::PCA9956(TwoWire *w) : wire(w)
@@ -31,10 +30,7 @@ PCA9956::PCA9956(TwoWire *w) : wire(w)
 void PCA9956::init(uint8_t devAddress, uint8_t ledBrightness, bool enablePWM, bool resetStatus_all)
 {
     _deviceAddress = devAddress;
-    #ifdef SERIAL_DEBUG
-    Serial.println();
-    Serial.println(devAddress);
-    #endif
+    LOG(LOG_PCA_INIT, devAddress, enablePWM);
 
     if (resetStatus_all)
     {
@@ -47,13 +43,77 @@ void PCA9956::init(uint8_t devAddress, uint8_t ledBrightness, bool enablePWM, bo
         setLEDOutMode_all(LEDMODE_FULLOFF); // set leds to full off
 
         isPWM = false;
+        setLEDCurrent_all(ledBrightness);
     }
     else
     {
-        setPWMMode_all(true);
+        isPWM = true;
+        PCA9956Cmd::initPWM(*wire, _deviceAddress, ledBrightness);
+        for (uint8_t i = 0; i < PCA9965_NUM_LEDS; i++) ledStatus[i] = 0;
     }
+}
 
-    setLEDCurrent_all(ledBrightness);
+/****************************** Shared Commands ***********************************/
+uint8_t PCA9956Cmd::write(TwoWire &wire, uint8_t address, const uint8_t *data, uint8_t length)
+{
+    wire.beginTransmission(address);
+    for (uint8_t i = 0; i < length; i++)
+    {
+        wire.write(data[i]);
+    }
+    return endTransmission(wire, address, data[0], length);
+}
+
+void PCA9956Cmd::setLEDPattern(TwoWire &wire, uint8_t address, const uint8_t *pattern)
+{
+    wire.beginTransmission(address);
+    wire.write(PCA9956Reg::burst(PWM0));
+    for (uint8_t i = 0; i < PCA9965_NUM_LEDS; i++)
+    {
+        wire.write(pattern[i]);
+    }
+    endTransmission(wire, address, PCA9956Reg::burst(PWM0), PCA9965_NUM_LEDS + 1);
+}
+
+void PCA9956Cmd::setLEDCurrent_all(TwoWire &wire, uint8_t address, uint8_t irefFactor)
+{
+    // set current auto INCREMENT
+    uint8_t cmd[] = {MODE1, MODE1_SETTING_AUTO_INCREMENT_IREF};
+    write(wire, address, cmd, sizeof(cmd));
+
+    wire.beginTransmission(address);
+    wire.write(PCA9956Reg::burst(IREF0));
+    for (uint8_t i = 0; i < PCA9965_NUM_LEDS; i++)
+    {
+        wire.write(irefFactor);
+    }
+    endTransmission(wire, address, PCA9956Reg::burst(IREF0), PCA9965_NUM_LEDS + 1);
+
+    // stop auto INCREMENT
+    cmd[1] = MODE1_SETTING_NO_INCREMENT;
+    write(wire, address, cmd, sizeof(cmd));
+}
+
+void PCA9956Cmd::setPWMMode_all(TwoWire &wire, uint8_t address)
+{
+    // set pwm auto INCREMENT
+    uint8_t cmd[] = {MODE1, MODE1_SETTING_AUTO_INCREMENT_BRIGHTNESS};
+    write(wire, address, cmd, sizeof(cmd));
+
+    cmd[1] = LEDMODE_PWM;
+    for (uint8_t i = 0; i < PCA9965_NUM_LEDS / 4; i++)
+    {
+        cmd[0] = PCA9956Reg::ledOut(i);
+        write(wire, address, cmd, sizeof(cmd));
+    }
+}
+
+void PCA9956Cmd::initPWM(TwoWire &wire, uint8_t address, uint8_t irefFactor)
+{
+    uint8_t pattern[PCA9965_NUM_LEDS] = {0};
+    setLEDPattern(wire, address, pattern);
+    setPWMMode_all(wire, address);
+    setLEDCurrent_all(wire, address, irefFactor);
 }
 
 // send software reset to all devices
@@ -65,45 +125,34 @@ void PCA9956::resetAllDevices()
     delay(1);
 }
 
-void PCA9956::i2cWrite(uint8_t slave_address, uint8_t *data, uint8_t dataLength)
+uint8_t PCA9956::i2cWrite(uint8_t slave_address, uint8_t *data, uint8_t dataLength)
 {
-    wire->beginTransmission(slave_address);
-    for (int i = 0; i < dataLength; i++)
-    {
-        wire->write(*(data + i));
-    }
-    wire->endTransmission();
+    return PCA9956Cmd::write(*wire, slave_address, data, dataLength);
 }
 
 // i2c scanner taken from here: https://playground.arduino.cc/Main/I2cScanner
-uint8_t PCA9956::i2cScan(uint8_t startAddress)
+uint8_t i2cScanRange(TwoWire *wire, uint8_t first, uint8_t last, uint8_t *found, uint8_t maxFound)
 {
-    uint8_t foundAddress = 0;
-    for (uint8_t address = startAddress; address < 127; address++)
+    uint8_t numFound = 0;
+    for (uint8_t address = first; address <= last && numFound < maxFound; address++)
     {
         // The i2c_scanner uses the return value of
         // the Write.endTransmisstion to see if
         // a device did acknowledge to the address.
         wire->beginTransmission(address);
-        uint8_t error = wire->endTransmission();
-
-        if (error == 0)
+        if (wire->endTransmission() == 0)
         {
-            Serial.print("\nI2C device found at address 0x");
-            if (address < 16)
-                Serial.print("0");
-            Serial.println(address, HEX);
-            foundAddress = address;
-            break;
-        }
-        else if (error == 4)
-        {
-            Serial.print("Unknown error at address 0x");
-            if (address < 16)
-                Serial.print("0");
-            Serial.println(address, HEX);
+            found[numFound++] = address;
         }
     }
+    return numFound;
+}
+
+// Returns the first address from startAddress on that acknowledges, or 0
+uint8_t PCA9956::i2cScan(uint8_t startAddress)
+{
+    uint8_t foundAddress = 0;
+    i2cScanRange(wire, startAddress, 126, &foundAddress, 1);
     return foundAddress;
 }
 
@@ -116,9 +165,7 @@ void PCA9956::setPWMMode_all(bool setAllLEDsOff)
         setLEDPattern(pattern);
     }
 
-    // set pwm auto INCREMENT
-    ledMode1Setting(MODE1_SETTING_AUTO_INCREMENT_BRIGHTNESS);
-    setLEDOutMode_all(LEDMODE_PWM);
+    PCA9956Cmd::setPWMMode_all(*wire, _deviceAddress);
 }
 
 // LED No: 0 - 23
@@ -127,7 +174,7 @@ void PCA9956::setLEDCurrent(uint8_t LEDNo, uint8_t irefFactor)
     if (LEDNo < PCA9965_NUM_LEDS)
     {
         uint8_t cmd[2];
-        cmd[0] = LEDNo + IREF0;
+        cmd[0] = PCA9956Reg::iref(LEDNo);
         cmd[1] = irefFactor;
         i2cWrite(_deviceAddress, cmd, sizeof(cmd));
     }
@@ -135,17 +182,7 @@ void PCA9956::setLEDCurrent(uint8_t LEDNo, uint8_t irefFactor)
 
 void PCA9956::setLEDCurrent_all(uint8_t irefFactor)
 {
-    // set current auto INCREMENT
-    ledMode1Setting(MODE1_SETTING_AUTO_INCREMENT_IREF);
-    uint8_t cmd[25];
-    cmd[0] = IREF0 | AUTO_INCREMENT_BIT;
-    for(uint8_t i = 1; i < 25; i++)
-        cmd[i] = irefFactor;
-
-    i2cWrite(_deviceAddress, cmd, sizeof(cmd));
-
-    // stop auto INCREMENT
-    ledMode1Setting(MODE1_SETTING_NO_INCREMENT);
+    PCA9956Cmd::setLEDCurrent_all(*wire, _deviceAddress, irefFactor);
 }
 
 //MODE1 reg setting
@@ -165,7 +202,7 @@ void PCA9956::setLEDOutMode_all(uint8_t mode)
 
     for(uint8_t i = 0; i < 6; i ++)
     {
-        cmd[0] = LEDOUT0 + i;
+        cmd[0] = PCA9956Reg::ledOut(i);
         i2cWrite(_deviceAddress, cmd, sizeof(cmd));
     }
 }
@@ -179,14 +216,7 @@ void PCA9956::setLEDOutMode(uint8_t regAdr, uint8_t mode)
 
     i2cWrite(_deviceAddress, cmd, sizeof(cmd));
 
-#ifdef SERIAL_DEBUG
-    Serial.print(_deviceAddress, HEX);
-    Serial.print(" ");
-    Serial.print(regAdr, HEX);
-    Serial.print(" ");
-    Serial.print(mode, BIN);
-    Serial.println("");
-#endif
+    LOG(LOG_PCA_LEDOUT, _deviceAddress, regAdr, mode);
 }
 
 void PCA9956::onLED(uint8_t LEDNo)
@@ -197,11 +227,9 @@ void PCA9956::onLED(uint8_t LEDNo)
             setLEDOutMode_all(LEDMODE_FULLOFF);
         isPWM = false;
 
-        #ifdef SERIAL_DEBUG
-        Serial.print("on  ");
-        #endif
+        LOG(LOG_PCA_ON, _deviceAddress, LEDNo);
         uint8_t LEDgroup = uint8_t(LEDNo / 4);
-        uint8_t regAdr = LEDgroup + LEDOUT0;
+        uint8_t regAdr = PCA9956Reg::ledOut(LEDgroup);
         uint8_t regVal = 1 << ((LEDNo % 4) * 2);
 
         for (uint8_t i = 0; i < 4; i++)
@@ -230,12 +258,10 @@ void PCA9956::offLED(uint8_t LEDNo)
             setLEDOutMode_all(LEDMODE_FULLOFF);
         isPWM = false;
 
-        #ifdef SERIAL_DEBUG
-        Serial.print("off ");
-        #endif
+        LOG(LOG_PCA_OFF, _deviceAddress, LEDNo);
 
         uint8_t LEDGroup = (LEDNo / 4);
-        uint8_t regAdr = LEDGroup + LEDOUT0;
+        uint8_t regAdr = PCA9956Reg::ledOut(LEDGroup);
         
         // check other leds' status
         uint8_t registerValue = 0;
@@ -260,27 +286,16 @@ void PCA9956::setLEDPattern(uint8_t *pattern)
 {
     if(!isPWM) setPWMMode_all();
 
-    #ifdef SERIAL_DEBUG
-    Serial.print("pwm0: ");
-    Serial.println(pattern[0]);
-    #endif
+    LOG(LOG_PCA_PATTERN, _deviceAddress, pattern[0]);
 
-
-        uint8_t cmd[25];
-    cmd[0] = PWM0 | AUTO_INCREMENT_BIT;
-    for (uint8_t i = 1; i < 25; i++)
-    {
-        cmd[i] = pattern[i - 1];
-    }
-
-    i2cWrite(_deviceAddress, cmd, sizeof(cmd));
+    PCA9956Cmd::setLEDPattern(*wire, _deviceAddress, pattern);
 
     // stores led status
     for (uint8_t i = 0; i < PCA9965_NUM_LEDS; i++) ledStatus[i] = pattern[i];
 }
 
 // LED No: 0 - 23
-void PCA9956::pwmLED(uint8_t LEDNo, uint8_t PWMPower)
+uint8_t PCA9956::pwmLED(uint8_t LEDNo, uint8_t PWMPower)
 {
     if (!isPWM)
     {
@@ -290,11 +305,12 @@ void PCA9956::pwmLED(uint8_t LEDNo, uint8_t PWMPower)
     if(LEDNo < PCA9965_NUM_LEDS)
     {
         uint8_t cmd[2];
-        cmd[0] = PWM0 + LEDNo;
+        cmd[0] = PCA9956Reg::pwm(LEDNo);
         cmd[1] = PWMPower;
 
-        i2cWrite(_deviceAddress, cmd, 2);
+        return i2cWrite(_deviceAddress, cmd, 2);
     }
+    return 0;
 }
 
 // read out one byte from regester
@@ -304,10 +320,10 @@ uint8_t PCA9956::readRegisterStatus(uint8_t regAddress)
     wire->write(regAddress);
     wire->endTransmission();
 
-    Wire.requestFrom(_deviceAddress, 1);
-    while (Wire.available() < 1)
+    wire->requestFrom(_deviceAddress, (uint8_t)1);
+    while (wire->available() < 1)
         delay(1);
-    uint8_t status = Wire.read();
+    uint8_t status = wire->read();
 
     return status;
 }
@@ -27,6 +27,8 @@
 
 #include <Arduino.h>
 #include <Wire.h>
+#include <Trace.h>
+#include <BinLog.h>
 
 //PCA9956 registor addresses
 #define MODE1 0x00
@@ -63,6 +65,46 @@
 
 #define PCA9965_NUM_LEDS 24 // Fixed value
 
+// Register addresses and command headers, usable at compile time
+namespace PCA9956Reg
+{
+    constexpr uint8_t pwm(uint8_t LEDNo) { return PWM0 + LEDNo; }
+    constexpr uint8_t iref(uint8_t LEDNo) { return IREF0 + LEDNo; }
+    constexpr uint8_t ledOut(uint8_t LEDGroup) { return LEDOUT0 + LEDGroup; }
+    // first byte of an auto-incrementing burst starting at regAddress
+    constexpr uint8_t burst(uint8_t regAddress) { return regAddress | AUTO_INCREMENT_BIT; }
+}
+
+// Command sequences shared by PCA9956 and PCA9956Fixed, so both drive the chip
+// the same way. Each takes the bus and address of the chip to talk to.
+namespace PCA9956Cmd
+{
+    // Finishes a transmission started with beginTransmission(): logs errors and
+    // traces the write. Inline so PCA9956Fixed's single writes stay constant.
+    // Returns Wire's error, 0 on success.
+    inline uint8_t endTransmission(TwoWire &wire, uint8_t address, uint8_t firstByte, uint8_t length)
+    {
+        uint8_t error = wire.endTransmission();
+        if (error)
+            LOG(LOG_I2C_ERROR, error, address);
+        TRACE(TRACE_I2C, address, (firstByte << 8) | length);
+        return error;
+    }
+
+    uint8_t write(TwoWire &wire, uint8_t address, const uint8_t *data, uint8_t length);
+    // Writes all 24 PWM registers in one burst, pattern uint8_t[0-255 x24]
+    void setLEDPattern(TwoWire &wire, uint8_t address, const uint8_t *pattern);
+    void setLEDCurrent_all(TwoWire &wire, uint8_t address, uint8_t irefFactor);
+    // Auto increment over the brightness registers, all LEDs under PWM control
+    void setPWMMode_all(TwoWire &wire, uint8_t address);
+    // All LEDs off in PWM mode, every LED's current set to irefFactor
+    void initPWM(TwoWire &wire, uint8_t address, uint8_t irefFactor);
+}
+
+// Probes addresses first..last (inclusive) in one pass and stores the ones that
+// acknowledge in found[], up to maxFound. Returns the number found.
+uint8_t i2cScanRange(TwoWire *wire, uint8_t first, uint8_t last, uint8_t *found, uint8_t maxFound);
+
 class PCA9956{
     public:
         PCA9956(TwoWire*);  //Initializer
@@ -74,8 +116,8 @@ class PCA9956{
         void onLED(uint8_t LEDNo);
         // Turns off individual LED
         void offLED(uint8_t LEDNo);
-        // individually controls led with pwm
-        void pwmLED(uint8_t LEDNo, uint8_t PWMPower);
+        // individually controls led with pwm, returns the I2C error (0 on success)
+        uint8_t pwmLED(uint8_t LEDNo, uint8_t PWMPower);
         // Controls all 24 leds at once with pattern uint8_t[0-255, 0-255....]
         void setLEDPattern(uint8_t *LEDPattern);
         // Sets individual current
@@ -96,7 +138,7 @@ class PCA9956{
         void ledMode1Setting(uint8_t regsetting);
         void setLEDCurrent_all(uint8_t iref);
         void setLEDOutMode(uint8_t registorAddress, uint8_t mode);
-        void i2cWrite(uint8_t slave_address, uint8_t *data, uint8_t dataLength);
+        uint8_t i2cWrite(uint8_t slave_address, uint8_t *data, uint8_t dataLength);
         uint8_t readRegisterStatus(uint8_t regAddress);
         void clearMode2Error();
 
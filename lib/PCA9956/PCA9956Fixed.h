@@ -0,0 +1,67 @@
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+/**
+ * @file    PCA9956Fixed.h
+ * @brief   PCA9956 driver specialized at compile time on bus and address
+ *
+ * \par Description
+ * For chips whose bus and address are known when the firmware is built.
+ * Register commands are constant expressions and every write goes straight to
+ * the bus object without a pointer or address load. init() puts the chip in PWM
+ * mode and nothing here leaves it, so pwmLED() has no mode check at all.
+ * Use PCA9956 when the address is only known at runtime, or for full on/off mode.
+ */
+
+#ifndef _PCA9956_FIXED_H_
+#define _PCA9956_FIXED_H_
+
+#include "PCA9956.h"
+
+// Only pwmLED() and setLEDCurrent(), which run per LED, are specialized here.
+// Everything else is the same PCA9956Cmd sequence the runtime class uses.
+template <TwoWire& wire, uint8_t deviceAddress>
+class PCA9956Fixed{
+    public:
+        static constexpr uint8_t address = deviceAddress;
+
+        void init(uint8_t ledBrightness)
+        {
+            PCA9956Cmd::initPWM(wire, address, ledBrightness);
+        }
+
+        // LED No: 0 - 23. Returns the I2C error, 0 on success.
+        uint8_t pwmLED(uint8_t LEDNo, uint8_t PWMPower)
+        {
+            if (LEDNo < PCA9965_NUM_LEDS)
+                return writeRegister(PCA9956Reg::pwm(LEDNo), PWMPower);
+            return 0;
+        }
+
+        // Controls all 24 leds at once with pattern uint8_t[0-255, 0-255....]
+        void setLEDPattern(const uint8_t *pattern)
+        {
+            PCA9956Cmd::setLEDPattern(wire, address, pattern);
+        }
+
+        // LED No: 0 - 23
+        void setLEDCurrent(uint8_t LEDNo, uint8_t irefFactor)
+        {
+            if (LEDNo < PCA9965_NUM_LEDS)
+                writeRegister(PCA9956Reg::iref(LEDNo), irefFactor);
+        }
+
+        void setLEDCurrent_all(uint8_t irefFactor)
+        {
+            PCA9956Cmd::setLEDCurrent_all(wire, address, irefFactor);
+        }
+
+    private:
+        static uint8_t writeRegister(uint8_t regAddress, uint8_t value)
+        {
+            wire.beginTransmission(address);
+            wire.write(regAddress);
+            wire.write(value);
+            return PCA9956Cmd::endTransmission(wire, address, regAddress, 2);
+        }
+};
+
+#endif
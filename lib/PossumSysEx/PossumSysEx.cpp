@@ -0,0 +1,42 @@
+#include "PossumSysEx.h"
+
+uint16_t sysexPack(const uint8_t* in, uint16_t length, uint8_t* out) {
+  uint16_t o = 0;
+  for (uint16_t i = 0; i < length; i += 7) {
+    uint8_t group = min(7, length - i);
+    uint8_t highBits = 0;
+    for (uint8_t j = 0; j < group; j++) {
+      highBits |= ((in[i + j] >> 7) & 1) << j;
+    }
+    out[o++] = highBits;
+    for (uint8_t j = 0; j < group; j++) {
+      out[o++] = in[i + j] & 0x7F;
+    }
+  }
+  return o;
+}
+
+void sysexSend(uint8_t command, uint8_t seq, const uint8_t* payload, uint16_t length) {
+  uint8_t msg[5 + sysexPackedLength(SYSEX_MAX_PAYLOAD)];
+  if (length > SYSEX_MAX_PAYLOAD) {
+    length = SYSEX_MAX_PAYLOAD;
+  }
+
+  uint16_t n = 0;
+  msg[n++] = 0xF0;
+  msg[n++] = SYSEX_MANUFACTURER_ID;
+  msg[n++] = command & 0x7F;
+  msg[n++] = seq & 0x7F;
+  n += sysexPack(payload, length, msg + n);
+  msg[n++] = 0xF7;
+
+  usbMIDI.sendSysEx(n, msg, true);
+}
+
+uint8_t sysexCommand(const uint8_t* data, unsigned int size) {
+  // F0 7D <command> ... F7
+  if (size < 4 || data[0] != 0xF0 || data[1] != SYSEX_MANUFACTURER_ID) {
+    return 0;
+  }
+  return data[2];
+}
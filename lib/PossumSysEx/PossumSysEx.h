@@ -0,0 +1,36 @@
+#ifndef _POSSUM_SYSEX_H_
+#define _POSSUM_SYSEX_H_
+
+#include <Arduino.h>
+
+// All of our SysEx messages look like F0 7D <command> <payload...> F7.
+// 0x7D is the MIDI "non-commercial / educational" manufacturer ID.
+#define SYSEX_MANUFACTURER_ID 0x7D
+
+// Chunk size for replies too long for one message (the trace dump); they are
+// split into several messages, each starting with a sequence byte.
+#define SYSEX_MAX_CHUNK 70
+// Largest unpacked payload sysexSend() takes; the packed message is built on the stack
+#define SYSEX_MAX_PAYLOAD 200
+
+enum SysExCommand : uint8_t {
+  SYSEX_TRACE_DUMP = 0x01,  // request: none, reply: <seq> <packed trace bytes>, seq 0x7F ends the dump
+  SYSEX_TRACE_CLEAR = 0x02, // request: none, no reply
+  SYSEX_BENCHMARK = 0x03,   // request: none, reply: <0> <packed results>, see runBenchmark() in main.cpp
+  SYSEX_PANEL_COUNT = 0x04, // request: none, reply: <0> <packed u8 panels found at boot>
+};
+
+// Payload bytes are 8 bit, so they go out 7-bit packed: every group of up to 7
+// bytes becomes one byte holding their high bits (bit 0 = first byte) followed
+// by the 7 low bits of each byte.
+constexpr uint16_t sysexPackedLength(uint16_t length) { return length + (length + 6) / 7; }
+uint16_t sysexPack(const uint8_t* in, uint16_t length, uint8_t* out);
+
+// Sends F0 7D <command> <seq> <packed payload> F7. length must be <= SYSEX_MAX_PAYLOAD.
+void sysexSend(uint8_t command, uint8_t seq, const uint8_t* payload, uint16_t length);
+
+// Returns the command byte of one of our messages, or 0 if the message isn't ours.
+// data/size are as passed to usbMIDI's SysEx handler (including F0 and F7).
+uint8_t sysexCommand(const uint8_t* data, unsigned int size);
+
+#endif
@@ -0,0 +1,61 @@
+#include "Trace.h"
+#include <PossumSysEx.h>
+
+#ifdef POSSUM_TRACE
+TraceRing trace;
+#endif
+
+void TraceRing::clear() {
+  head = 0;
+  size = 0;
+}
+
+void TraceRing::header(TraceHeader& h) const {
+  memcpy(h.magic, "PTRC", 4);
+  h.version = TRACE_VERSION;
+  h.reserved = 0;
+  h.count = size;
+}
+
+const TraceRecord& TraceRing::at(uint16_t i) const {
+  return records[(head - size + i) & (TRACE_RING_SIZE - 1)];
+}
+
+void TraceRing::dump(Print& out) const {
+  TraceHeader h;
+  header(h);
+  out.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h));
+  for (uint16_t i = 0; i < size; i++) {
+    out.write(reinterpret_cast<const uint8_t*>(&at(i)), sizeof(TraceRecord));
+  }
+}
+
+void TraceRing::dumpSysEx() const {
+  // Same bytes as dump(), split into one message per SYSEX_MAX_CHUNK bytes
+  uint8_t chunk[SYSEX_MAX_CHUNK];
+  uint8_t seq = 0;
+  uint16_t n = 0;
+
+  auto add = [&](const void* data, uint16_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (uint16_t i = 0; i < length; i++) {
+      chunk[n++] = bytes[i];
+      if (n == SYSEX_MAX_CHUNK) {
+        sysexSend(SYSEX_TRACE_DUMP, seq, chunk, n);
+        seq = (seq + 1) % 0x7F; // 0x7F marks the end of the dump
+        n = 0;
+      }
+    }
+  };
+
+  TraceHeader h;
+  header(h);
+  add(&h, sizeof(h));
+  for (uint16_t i = 0; i < size; i++) {
+    add(&at(i), sizeof(TraceRecord));
+  }
+  if (n > 0) {
+    sysexSend(SYSEX_TRACE_DUMP, seq, chunk, n);
+  }
+  sysexSend(SYSEX_TRACE_DUMP, 0x7F, chunk, 0);
+}
@@ -0,0 +1,88 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <Arduino.h>
+
+// Compact in-RAM event trace for chasing latency complaints. The ring always
+// holds the most recent TRACE_RING_SIZE events and can be dumped over Serial
+// or SysEx after the fact. tools/replay feeds a dump back through the firmware
+// on the host.
+//
+// Recording is compiled in with -D POSSUM_TRACE; without it TRACE() is a no-op
+// and the ring takes no RAM.
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 128 // Must be a power of two; each record is 8 bytes
+#endif
+
+#define TRACE_VERSION 3 // 2: pot readings are 12 bit, 3: MIDI channel in type
+
+enum TraceType : uint8_t {
+  TRACE_BUTTON = 1, // id: cc, value: 1 pressed / 0 released (debounced)
+  TRACE_POT = 2,    // id: cc, value: filtered 12-bit ADC reading
+  TRACE_CC_IN = 3,  // id: cc, value: CC value
+  TRACE_CC_OUT = 4, // id: cc, value: CC value
+  TRACE_I2C = 5,    // id: 7-bit address, value: (first data byte << 8) | length
+};
+
+// Chained panels reuse the same CCs on the next channels, so records of MIDI
+// controls carry their channel, minus one, in the high nibble of the type byte.
+// Record them with TRACE_MIDI().
+#define TRACE_TYPE(type) ((type) & 0x0F)
+#define TRACE_CHANNEL(type) (((type) >> 4) + 1)
+
+struct TraceRecord {
+  uint32_t time; // micros()
+  uint8_t type;  // TraceType, and the MIDI channel for the first four
+  uint8_t id;
+  uint16_t value;
+};
+
+// Dump layout, little endian:
+//   "PTRC" <version u8> <reserved u8> <count u16> <count x TraceRecord, oldest first>
+struct TraceHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t count;
+};
+
+class TraceRing {
+  public:
+    void record(uint8_t type, uint8_t id, uint16_t value) {
+      TraceRecord& r = records[head];
+      r.time = micros();
+      r.type = type;
+      r.id = id;
+      r.value = value;
+      head = (head + 1) & (TRACE_RING_SIZE - 1);
+      if (size < TRACE_RING_SIZE) {
+        size++;
+      }
+    }
+
+    void clear();
+    uint16_t count() const { return size; }
+
+    void dump(Print& out) const;
+    void dumpSysEx() const;
+
+  private:
+    void header(TraceHeader& h) const;
+    const TraceRecord& at(uint16_t i) const; // 0 = oldest
+
+    TraceRecord records[TRACE_RING_SIZE];
+    uint16_t head = 0;
+    uint16_t size = 0;
+};
+
+#ifdef POSSUM_TRACE
+extern TraceRing trace;
+#define TRACE(type, id, value) trace.record((type), (id), (value))
+#define TRACE_MIDI(type, channel, id, value) trace.record((type) | (((channel) - 1) << 4), (id), (value))
+#else
+#define TRACE(type, id, value) do {} while (0)
+#define TRACE_MIDI(type, channel, id, value) do {} while (0)
+#endif
+
+#endif
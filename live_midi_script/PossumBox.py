@@ -1,4 +1,5 @@
 from __future__ import absolute_import, print_function, unicode_literals
+import Live
 from _Framework.ControlSurface import ControlSurface
 from _Framework.InputControlElement import *
 from _Framework.MixerComponent import MixerComponent
@@ -9,7 +10,18 @@ from _Framework.SceneComponent import SceneComponent
 from _Framework.ClipSlotComponent import ClipSlotComponent
 from _Framework.TransportComponent import TransportComponent
 
-NUM_TRACKS = 8
+# Chained button panels (see discoverPanels() in the firmware). Panel n covers
+# tracks 8n to 8n+7 on MIDI channel MIDI_CHANNEL + n, with the same CC layout.
+# Pots only exist on the main panel. The device reports how many it found when
+# the script connects.
+PANEL_TRACKS = 8
+
+# SysEx F0 7D <command> ... F7, see lib/PossumSysEx in the firmware
+SYSEX_MANUFACTURER_ID = 0x7D
+SYSEX_PANEL_COUNT = 0x04
+# Ticks (100 ms each) to wait for the panel count before assuming one panel,
+# as with firmware that doesn't answer
+PANEL_COUNT_TIMEOUT = 5
 
 MIDI_CHANNEL = 8 - 1 # Live adds 1 to this for some reason
 TRACK_COUNT_CC = 126
@@ -23,19 +35,58 @@ MASTER_POT_2_CC = 116
 MASTER_POT_3_CC = 117
 MASTER_POT_4_CC = 118
 
+# Must match POT_HIGH_RES in the firmware. In high res mode pots send 14-bit
+# MSB/LSB pairs (CC n / n + 32) on their own channel.
+POT_HIGH_RES = False
+POT_HIGH_RES_CHANNEL = 16 - 1
+POT_HIGH_RES_CC_BASE = 16
+
+# Button LED states, sent as the CC value (LedState in the firmware). Buttons
+# animate the in-between ones themselves.
+LED_OFF = 0
+LED_QUEUED = 1
+LED_RECORDING = 2
+LED_STOPPED = 3
+LED_ON = 127
+
 
 sendMidi = [None]
 
 lastPlayedClipByTrack = {}
+lastLedStateByTrack = {}
 
 def getCcBase(trackIndex):
-    return BUTTON_CC_BASE + (15 - (trackIndex * 2))
+    return BUTTON_CC_BASE + (15 - ((trackIndex % PANEL_TRACKS) * 2))
+
+def getChannel(trackIndex):
+    return MIDI_CHANNEL + trackIndex // PANEL_TRACKS
 
-def sendCc(cc, value):
+def getPotCc(potIndex):
+    return (POT_HIGH_RES_CC_BASE if POT_HIGH_RES else POT_CC_BASE) + potIndex
+
+def getPotChannel():
+    return POT_HIGH_RES_CHANNEL if POT_HIGH_RES else MIDI_CHANNEL
+
+def makePotControl(potIndex):
+    sliderType = _HighResSliderElement if POT_HIGH_RES else SliderElement
+    return sliderType(MIDI_CC_TYPE, getPotChannel(), getPotCc(potIndex))
+
+def sendCc(cc, value, channel=MIDI_CHANNEL):
     # See InputControlElement._do_send_value()
-    status_byte = MIDI_CHANNEL + MIDI_CC_STATUS
+    status_byte = channel + MIDI_CC_STATUS
     sendMidi[0]((status_byte, cc, value))
 
+def getLedState(track, previous):
+    # fired_slot_index is -2 while a stop is waiting for quantization
+    if track.fired_slot_index != -1:
+        return LED_QUEUED
+    if track.playing_slot_index >= 0:
+        if track.clip_slots[track.playing_slot_index].is_recording:
+            return LED_RECORDING
+        return LED_ON
+    # Stays stopped (the button ends up looking off) so the fade isn't cut short
+    return LED_OFF if previous == LED_OFF else LED_STOPPED
+
 
 class _ClipSlotComponent(ClipSlotComponent):
     def __init__(self, *a, **kw):
@@ -55,14 +106,18 @@ class _ClipSlotComponent(ClipSlotComponent):
             self._wasPlaying = False
             return
 
-        if self._clip_slot.is_playing != self._wasPlaying:
-            if self._clip_slot.is_playing:
-                lastPlayedClipByTrack[self._trackIndex] = self._clip_slot
+        if self._clip_slot.is_playing and not self._wasPlaying:
+            lastPlayedClipByTrack[self._trackIndex] = self._clip_slot
+        self._wasPlaying = self._clip_slot.is_playing
+
+        # Every slot of the track shares the one button, so show the track's state
+        previous = lastLedStateByTrack.get(self._trackIndex, LED_OFF)
+        state = getLedState(self._clip_slot.canonical_parent, previous)
+        if state != previous:
+            lastLedStateByTrack[self._trackIndex] = state
             # eg track 0 -> cc 81 (P1)
             cc = getCcBase(self._trackIndex) + PLAY_BTN_OFFSET
-            sendCc(cc, 127 if self._clip_slot.is_playing else 0)
-        
-        self._wasPlaying = self._clip_slot.is_playing
+            sendCc(cc, state, getChannel(self._trackIndex))
 
 
 
@@ -94,15 +149,21 @@ class _SessionComponent(SessionComponent):
         return sc
 
 
+class _HighResSliderElement(SliderElement):
+    # Live pairs CC n with n + 32 itself in this mode
+    def message_map_mode(self):
+        return Live.MidiMap.MapMode.absolute_14_bit
+
+
 class StopPlayButtonElement(ButtonElement):
     def __init__(self, session, track, cc):
-        ButtonElement.__init__(self, True, MIDI_CC_TYPE, MIDI_CHANNEL, cc)
+        ButtonElement.__init__(self, True, MIDI_CC_TYPE, getChannel(track), cc)
         self._session = session
         self._track = track
 
     def receive_value(self, value):
-        # NOTE: This does not change the LED state
-        # Idea: blink LED while clip is waiting to start
+        # NOTE: This does not change the LED state; it blinks once Live
+        # reports the clip waiting to start (see getLedState())
         tracks = self._session.tracks_to_use()
         if self._track >= len(tracks):
             return
@@ -170,47 +231,118 @@ class _ToggleComponent(ControlSurfaceComponent):
 
 
 
+class _PotFeedback(object):
+    """Sends the values of the parameters the pots control to the device, so
+    its soft takeover knows where Live is (see Pot::receive() in the firmware)."""
+
+    def __init__(self, song):
+        self._song = song
+        self._listeners = []
+
+    def disconnect(self):
+        for param, listener in self._listeners:
+            # Parameters of deleted tracks are dead; Live makes those compare
+            # equal to None and raises if they're used
+            if param != None and param.value_has_listener(listener):
+                param.remove_value_listener(listener)
+        self._listeners = []
+
+    def refresh(self):
+        self.disconnect()
+        tracks = self._song.visible_tracks
+        for track in range(min(PANEL_TRACKS, len(tracks))):
+            mixer = tracks[track].mixer_device
+            self._watch(mixer.volume, getPotCc(track))
+            # Same send as the U[n] mapping below
+            if len(mixer.sends) > 1:
+                self._watch(mixer.sends[1], getPotCc(8 + track))
+
+    def _watch(self, param, cc):
+        def listener():
+            # 7 bit even in high res mode, where it goes to the MSB
+            value = (param.value - param.min) / (param.max - param.min)
+            sendCc(cc, int(round(value * 127)), getPotChannel())
+        param.add_value_listener(listener)
+        self._listeners.append((param, listener))
+        listener()
+
+
+
 class PossumBox(ControlSurface):
     def __init__(self, c_instance):
         ControlSurface.__init__(self, c_instance)
+        self._numPanels = None
+        self._potFeedback = None
         with self.component_guard():
             sendMidi[0] = self._send_midi
             
             self._suggested_input_port = 'Teensy MIDI'
             self._suggested_output_port = 'Teensy MIDI'
 
+        self._send_midi((0xF0, SYSEX_MANUFACTURER_ID, SYSEX_PANEL_COUNT, 0xF7))
+        self.schedule_message(PANEL_COUNT_TIMEOUT, self._setup_controls, 1)
+
+    def handle_sysex(self, midi_bytes):
+        # Reply: F0 7D 04 <seq> <high bits> <count> F7
+        if len(midi_bytes) >= 6 and midi_bytes[1] == SYSEX_MANUFACTURER_ID and midi_bytes[2] == SYSEX_PANEL_COUNT:
+            self._setup_controls(midi_bytes[5] | ((midi_bytes[4] & 1) << 7))
+        else:
+            ControlSurface.handle_sysex(self, midi_bytes)
 
+    def _setup_controls(self, numPanels):
+        if self._numPanels is not None:
+            return
+        self._numPanels = numPanels
+        numTracks = PANEL_TRACKS * numPanels
+        self.log_message('PossumBox: %d panel(s)' % numPanels)
+        with self.component_guard():
             _ToggleComponent(self.song()).set_toggle_button(ButtonElement(True, MIDI_CC_TYPE, MIDI_CHANNEL, MASTER_PLAY_CC))
             
             TransportComponent().set_record_button(ButtonElement(True, MIDI_CC_TYPE, MIDI_CHANNEL, MASTER_REC_CC))
 
-            session = _SessionComponent(num_tracks = NUM_TRACKS, num_scenes = 100)
+            session = _SessionComponent(num_tracks = numTracks, num_scenes = 100)
             startStopButtons = []
 
-            mixer = MixerComponent(NUM_TRACKS)
-            for track in range(NUM_TRACKS):
+            mixer = MixerComponent(numTracks)
+            for track in range(numTracks):
                 strip = mixer.channel_strip(track)
 
-                ccBase = BUTTON_CC_BASE + (15 - (track * 2))
+                ccBase = getCcBase(track)
+                channel = getChannel(track)
 
-                strip.set_mute_button(ButtonElement(True, MIDI_CC_TYPE, MIDI_CHANNEL, ccBase))
+                strip.set_mute_button(ButtonElement(True, MIDI_CC_TYPE, channel, ccBase))
                 strip.set_invert_mute_feedback(True)
-                strip.set_solo_button(ButtonElement(True, MIDI_CC_TYPE, MIDI_CHANNEL, ccBase - 1))
-                strip.set_arm_button(ButtonElement(True, MIDI_CC_TYPE, MIDI_CHANNEL, ccBase + 15))
+                strip.set_solo_button(ButtonElement(True, MIDI_CC_TYPE, channel, ccBase - 1))
+                strip.set_arm_button(ButtonElement(True, MIDI_CC_TYPE, channel, ccBase + 15))
                 
                 startStopButtons.append(StopPlayButtonElement(session, track, ccBase + PLAY_BTN_OFFSET))
 
-                strip.set_volume_control(SliderElement(MIDI_CC_TYPE, MIDI_CHANNEL, POT_CC_BASE + track))
+                if track >= PANEL_TRACKS:
+                    continue
+
+                strip.set_volume_control(makePotControl(track))
 
                 # U[n] default mapping, for now
                 # None for A (default delay), use it for B (reverb) instead
-                strip.set_send_controls([ None, SliderElement(MIDI_CC_TYPE, MIDI_CHANNEL, POT_CC_BASE + 8 + track) ])
+                strip.set_send_controls([ None, makePotControl(8 + track) ])
 
             # Note: No (default) mappings for the 4 master pots
                 
             session.set_stop_track_clip_buttons(startStopButtons)
 
+            self._potFeedback = _PotFeedback(self.song())
+            self._potFeedback.refresh()
+        # The device may have missed track counts sent before this
+        sendCc(TRACK_COUNT_CC, len(self.song().visible_tracks))
+
 
     def _on_track_list_changed(self):
         sendCc(TRACK_COUNT_CC, len(self.song().visible_tracks))
+        if self._potFeedback:
+            self._potFeedback.refresh()
         return ControlSurface._on_track_list_changed(self)
+
+    def disconnect(self):
+        if self._potFeedback:
+            self._potFeedback.disconnect()
+        ControlSurface.disconnect(self)
@@ -4,8 +4,11 @@
 #include <Wire.h>
 #include <Bounce2.h>
 #include <Adafruit_MCP23017.h>
-#include <PCA9956.h>
+#include <PCA9956Fixed.h>
 #include <Mux.h>
+#include <PossumSysEx.h>
+#include <Trace.h>
+#include <BinLog.h>
 
 
 #define MCP_ADDR_1 0x04
@@ -13,6 +16,67 @@
 #define PCA_ADDR_1 0x0B
 #define PCA_ADDR_2 0x0D
 
+// I2C bus for each group of devices. Everything is on Wire. On the LC, Wire1 is
+// pins 22/23, which this board uses as A8/A9 for the pot muxes (MUX_ADC_0/1), so
+// moving a group to Wire1 takes a board with the muxes elsewhere; it's refused
+// below otherwise. Transfers run one at a time either way: Wire blocks, and the
+// non-blocking i2c_t3 can't be used next to it (Adafruit_MCP23017 needs Wire).
+// LED writes are instead queued and spread over the scan, see flushLEDs().
+#define MCP_BUS Wire
+#define PCA_BUS Wire
+// Analog inputs of the two pot muxes
+#define MUX_ADC_0 A8
+#define MUX_ADC_1 A9
+
+// Token checks for the #error below: is a bus Wire1, is a pin one of Wire1's
+#define IS_WIRE1(bus) IS_WIRE1_(bus)
+#define IS_WIRE1_(bus) IS_WIRE1_##bus
+#define IS_WIRE1_Wire1 1
+#define IS_WIRE1_PIN(pin) IS_WIRE1_PIN_(pin)
+#define IS_WIRE1_PIN_(pin) IS_WIRE1_PIN_##pin
+#define IS_WIRE1_PIN_A8 1
+#define IS_WIRE1_PIN_A9 1
+#define IS_WIRE1_PIN_22 1
+#define IS_WIRE1_PIN_23 1
+#if (IS_WIRE1(MCP_BUS) || IS_WIRE1(PCA_BUS)) && (IS_WIRE1_PIN(MUX_ADC_0) || IS_WIRE1_PIN(MUX_ADC_1))
+#error "Wire1 is on pins 22/23 (A8/A9), which the pot muxes read"
+#endif
+// Both chips are fine up to 1 MHz; the SysEx benchmark reports what each unit
+// manages at each of BENCHMARK_CLOCKS before raising this
+#define I2C_CLOCK 100000
+#define BENCHMARK_CLOCKS { 100000, 400000, 1000000 }
+
+// Panels chained on the same buses are found at boot (see discoverPanels()).
+// Each has the same 2 MCP23017 + 2 PCA9956 layout as the built-in one and
+// shows up as 8 more tracks on the next MIDI channel.
+// Each extra panel's controls are allocated at boot; panels that would leave
+// less than MIN_FREE_RAM for the stack are skipped (and logged).
+#define MAX_EXTRA_PANELS 3
+#define MIN_FREE_RAM 1024
+#define PANEL_TRACKS 8
+#define PANEL_BUTTONS 32
+#define MAX_PCAS (2 * (1 + MAX_EXTRA_PANELS))
+#define MAX_MCPS (2 * (1 + MAX_EXTRA_PANELS))
+// MCP23017s can only live at 0x20-0x27. PCA9956s can use any other address
+// below their default LED All Call / sub addresses at 0x70.
+#define MCP_SCAN_FIRST 0x20
+#define MCP_SCAN_LAST 0x27
+#define PCA_SCAN_FIRST 0x01
+#define PCA_SCAN_LAST 0x6F
+// LED writes flushed after each control in the scan (see flushLEDs())
+#define LED_WRITES_PER_SLOT 1
+// Animations (see animateLEDs()) are recomputed at 1000 / LED_FRAME_MS fps and
+// may queue at most LED_FRAME_BYTES of I2C writes per frame, ~10% of a 100 kHz bus
+#define LED_FRAME_MS 20
+#define LED_FRAME_BYTES 24
+// Address, register and value
+#define LED_WRITE_BYTES 3
+// One per clip launch button on a full chain
+#define MAX_ANIMATED_LEDS (PANEL_TRACKS * (MAX_EXTRA_PANELS + 1))
+#define LED_BLINK_MS 250
+#define LED_PULSE_MS 1000
+#define LED_FADE_MS 400
+
 #define MIDI_CHANNEL 8
 #define TRACK_COUNT_CC 126
 #define POT_CC_BASE 20
@@ -26,19 +90,275 @@
 #define JOYSTICK_X_CC 119
 #define JOYSTICK_Y_CC 120
 
-// NOTE: The highest return value of brightness() multipled by this cannot exceed 255
-#define LED_HI_FACTOR 7
+// ADC setup shared by the pots and joystick. The LC's ADC does 12 bits and can
+// average several conversions in hardware, which is cheaper than filtering in software.
+#define ADC_BITS 12
+#define ADC_MAX ((1 << ADC_BITS) - 1)
+#define ADC_AVERAGING 4
+
+// Send pots as 14-bit MSB/LSB CC pairs (CC n / n + 32). Live can only map those
+// for n < 32, and the LSBs of the regular pot CCs would land on the buttons, so
+// in this mode pots use their own channel and CC numbers.
+#define POT_HIGH_RES false
+#define POT_HIGH_RES_CHANNEL 16
+#define POT_HIGH_RES_CC_BASE 16       // G1-G8, U1-U8: CC 16-31, LSB 48-63
+#define MASTER_POT_HIGH_RES_CC_BASE 12 // FX_1-FX_4: CC 12-15, LSB 44-47
+
+// The joystick is sampled on its own schedule, in between the other controls
+#define JOYSTICK_SAMPLE_US 2000
+// Radius around the calibrated center that reads as centered, out of 8192
+#define JOYSTICK_DEADZONE 400
+// Smallest change (out of 16384) worth sending; keeps ADC noise off the wire
+#define JOYSTICK_MIN_CHANGE 24
+// Send 14-bit MSB/LSB CC pairs on their own channel instead of 7-bit CCs, as
+// the pots do (Live can map these, unlike NRPN). The CCs are undefined in the
+// MIDI spec and below the high res pots', so no two controls share a CC number.
+#define JOYSTICK_HIGH_RES false
+#define JOYSTICK_HIGH_RES_CHANNEL 15
+#define JOYSTICK_HIGH_RES_X_CC 3 // LSB 35
+#define JOYSTICK_HIGH_RES_Y_CC 9 // LSB 41
+static_assert(JOYSTICK_HIGH_RES_X_CC < MASTER_POT_HIGH_RES_CC_BASE && JOYSTICK_HIGH_RES_Y_CC < MASTER_POT_HIGH_RES_CC_BASE,
+              "high res joystick and pot CCs must not overlap");
+
+// Light a toggle button's LED as soon as it's pressed instead of waiting for
+// Live to echo the new state. Live's value wins when it arrives; if it doesn't
+// arrive within OPTIMISTIC_TIMEOUT_MS the LED goes back to Live's last value.
+#define OPTIMISTIC_LEDS true
+#define OPTIMISTIC_TIMEOUT_MS 500
 
 #define MASTER_TRACK 255
 
+// Soft takeover: after Live reports a value for a pot's parameter that differs
+// from the knob's position (e.g. after switching sets), the pot stays silent
+// until it is turned past that value, instead of making the parameter jump.
+#define POT_TAKEOVER true
+// Values Live sends this soon after we sent one are its echo of our own change
+#define POT_ECHO_MS 300
+
+// Loops slower than this are logged
+#define SLOW_LOOP_US 20000
+
 
 Adafruit_MCP23017 mcp1;
 Adafruit_MCP23017 mcp2;
-Adafruit_MCP23017* mcps[] = { &mcp1, &mcp2 };
+Adafruit_MCP23017* mcps[MAX_MCPS] = { &mcp1, &mcp2 };
+
+PCA9956Fixed<PCA_BUS, PCA_ADDR_1> pca1;
+PCA9956Fixed<PCA_BUS, PCA_ADDR_2> pca2;
+// Chips on discovered panels; their addresses are only known at runtime
+PCA9956* extraPcas[MAX_PCAS - 2];
+uint8_t numPcas = 2;
+uint8_t numPanels = 1;
+
+// Returns the I2C error, 0 on success
+uint8_t pwmLED(uint8_t pcaInd, uint8_t pin, uint8_t value) {
+  if (pcaInd == 0) {
+    return pca1.pwmLED(pin, value);
+  }
+  else if (pcaInd == 1) {
+    return pca2.pwmLED(pin, value);
+  }
+  else {
+    return extraPcas[pcaInd - 2]->pwmLED(pin, value);
+  }
+}
+
+void setLEDCurrent(uint8_t pcaInd, uint8_t pin, uint8_t iref) {
+  if (pcaInd == 0) {
+    pca1.setLEDCurrent(pin, iref);
+  }
+  else if (pcaInd == 1) {
+    pca2.setLEDCurrent(pin, iref);
+  }
+  else {
+    extraPcas[pcaInd - 2]->setLEDCurrent(pin, iref);
+  }
+}
+
+// LED changes are queued here and written a few at a time in between controls,
+// so a burst of feedback from Live doesn't stall the button scan behind it.
+// Changing an LED again before it's flushed costs no extra write.
+uint8_t ledLevel[MAX_PCAS][PCA9965_NUM_LEDS];
+uint32_t ledDirty[MAX_PCAS];
+
+void queueLED(uint8_t pcaInd, uint8_t pin, uint8_t value) {
+  if (ledLevel[pcaInd][pin] == value) {
+    return;
+  }
+  ledLevel[pcaInd][pin] = value;
+  ledDirty[pcaInd] |= 1UL << pin;
+}
+
+void flushLEDs(uint8_t maxWrites) {
+  static uint8_t nextPca = 0;
+  for (uint8_t i = 0; i < numPcas && maxWrites > 0; i++) {
+    // Round robin so one busy chip can't starve the others
+    uint8_t pcaInd = nextPca;
+    nextPca = (nextPca + 1) % numPcas;
+    while (ledDirty[pcaInd] && maxWrites > 0) {
+      uint8_t pin = __builtin_ctz(ledDirty[pcaInd]);
+      ledDirty[pcaInd] &= ~(1UL << pin);
+      pwmLED(pcaInd, pin, ledLevel[pcaInd][pin]);
+      maxWrites--;
+    }
+  }
+}
+
+constexpr uint16_t isqrt(uint32_t n) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > n) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// PWM for a perceived brightness (both 0-255): gamma 2.5, as 255 * (level / 255)^2.5
+constexpr uint8_t ledGamma(uint8_t level) {
+  return isqrt((uint64_t)level * level * level * level * level / (255UL * 255 * 255));
+}
+
+struct GammaTable {
+  uint8_t pwm[256];
+  constexpr GammaTable() : pwm() {
+    for (uint16_t i = 0; i < 256; i++) {
+      pwm[i] = ledGamma(i);
+    }
+  }
+};
+constexpr GammaTable gammaTable;
+static_assert(gammaTable.pwm[0] == 0 && gammaTable.pwm[255] == 255, "gamma must span the PWM range");
+static_assert(ledGamma(117) == 36, "gamma 2.5 maps 117 to 255/7");
+
+// LEDs that change on their own. animateLEDs() recomputes them once per frame and
+// queues only the levels that changed, up to LED_FRAME_BYTES per frame; the rest
+// catch up on the next frame, so animations never crowd out the input scan.
+enum LedAnimation : uint8_t {
+  ANIM_BLINK, // hi and lo for LED_BLINK_MS each
+  ANIM_PULSE, // hi down to lo and back every LED_PULSE_MS
+  ANIM_FADE,  // hi down to lo over LED_FADE_MS, then stops
+};
+
+struct LedAnim {
+  uint8_t pcaInd;
+  uint8_t pin;
+  LedAnimation anim;
+  uint8_t lo;
+  uint8_t hi;
+  // Frame it started on. A blink or pulse joins the phase of one already
+  // running, so they all stay in step.
+  uint16_t phase;
+};
+LedAnim ledAnims[MAX_ANIMATED_LEDS];
+uint8_t numLedAnims = 0;
 
-PCA9956 pca1(&Wire);
-PCA9956 pca2(&Wire);
-PCA9956* pcas[] = { &pca1, &pca2 };
+uint16_t ledFrame() {
+  return millis() / LED_FRAME_MS;
+}
+
+uint8_t animationLevel(const LedAnim& a, uint16_t frames) {
+  switch (a.anim) {
+    case ANIM_BLINK:
+      return (frames / (LED_BLINK_MS / LED_FRAME_MS)) % 2 ? a.lo : a.hi;
+    case ANIM_PULSE: {
+      const uint16_t period = LED_PULSE_MS / LED_FRAME_MS;
+      uint16_t t = frames % period;
+      uint16_t ramp = t < period / 2 ? t : period - t;
+      return a.lo + (a.hi - a.lo) * gammaTable.pwm[255 - 255 * ramp / (period / 2)] / 255;
+    }
+    case ANIM_FADE:
+      if (frames >= LED_FADE_MS / LED_FRAME_MS) {
+        return a.lo;
+      }
+      return a.lo + (a.hi - a.lo) * gammaTable.pwm[255 - 255 * frames / (LED_FADE_MS / LED_FRAME_MS)] / 255;
+    default:
+      return a.hi;
+  }
+}
+
+void stopAnimation(uint8_t pcaInd, uint8_t pin) {
+  for (uint8_t i = 0; i < numLedAnims; i++) {
+    if (ledAnims[i].pcaInd == pcaInd && ledAnims[i].pin == pin) {
+      ledAnims[i] = ledAnims[--numLedAnims];
+      return;
+    }
+  }
+}
+
+void setLED(uint8_t pcaInd, uint8_t pin, uint8_t value) {
+  stopAnimation(pcaInd, pin);
+  queueLED(pcaInd, pin, value);
+}
+
+void animateLED(uint8_t pcaInd, uint8_t pin, LedAnimation anim, uint8_t lo, uint8_t hi) {
+  stopAnimation(pcaInd, pin);
+  if (numLedAnims == MAX_ANIMATED_LEDS) {
+    // Out of slots; at least show it's active
+    queueLED(pcaInd, pin, hi);
+    return;
+  }
+  uint16_t phase = ledFrame();
+  for (uint8_t i = 0; i < numLedAnims && anim != ANIM_FADE; i++) {
+    if (ledAnims[i].anim == anim) {
+      phase = ledAnims[i].phase;
+      break;
+    }
+  }
+  LedAnim& a = ledAnims[numLedAnims++];
+  a = { pcaInd, pin, anim, lo, hi, phase };
+  // The first level answers Live directly, so it's outside the frame budget
+  queueLED(pcaInd, pin, animationLevel(a, ledFrame() - phase));
+}
+
+void animateLEDs() {
+  static uint16_t lastFrame = 0;
+  // Where the last frame ran out of budget, so the same LEDs don't always lag
+  static uint8_t next = 0;
+  uint16_t frame = ledFrame();
+  if (frame == lastFrame) {
+    return;
+  }
+  lastFrame = frame;
+
+  uint8_t budget = LED_FRAME_BYTES;
+  for (uint8_t n = 0; n < numLedAnims; n++) {
+    uint8_t i = (next + n) % numLedAnims;
+    const LedAnim& a = ledAnims[i];
+    uint8_t level = animationLevel(a, frame - a.phase);
+    if (level == ledLevel[a.pcaInd][a.pin]) {
+      continue;
+    }
+    // Already queued LEDs are rewritten for free
+    if (!(ledDirty[a.pcaInd] & (1UL << a.pin))) {
+      if (budget < LED_WRITE_BYTES) {
+        next = i;
+        break;
+      }
+      budget -= LED_WRITE_BYTES;
+    }
+    queueLED(a.pcaInd, a.pin, level);
+  }
+
+  for (uint8_t i = 0; i < numLedAnims;) {
+    const LedAnim& a = ledAnims[i];
+    if (a.anim == ANIM_FADE && ledLevel[a.pcaInd][a.pin] == a.lo) {
+      ledAnims[i] = ledAnims[--numLedAnims];
+    }
+    else {
+      i++;
+    }
+  }
+}
 
 admux::Mux mux(admux::Pin(A0, INPUT, admux::PinType::Analog), admux::Pinset(8, 9, 10));
 
@@ -51,27 +371,50 @@ int freeRam() {
 }
 
 
+void sendCc(uint8_t cc, uint8_t value, uint8_t channel = MIDI_CHANNEL) {
+  usbMIDI.sendControlChange(cc, value, channel);
+  TRACE_MIDI(TRACE_CC_OUT, channel, cc, value);
+}
 
-enum Color { RED, GREEN, BLUE, WHITE, YELLOW };
 
-uint8_t brightness(Color color) {
-  // Base brightness (PWM, 0-255) for each color. Must not exceed 255/LED_HI_FACTOR.
-  switch (color) {
-    case Color::RED:
-      return 20;
-    case Color::GREEN:
-      return 14;
-    case Color::BLUE:
-      return 10;
-    case Color::WHITE:
-      return 28;
-    case Color::YELLOW:
-      return 28;
-    default:
-      return 0;
-  }
+// Set while runBenchmark() runs. The loop() passes it times read MIDI, so a
+// request arriving meanwhile waits for this run to finish, and they poll
+// disabled buttons too, so the figure doesn't depend on Live's track count.
+bool benchmarking = false;
 
-}
+
+enum Color : uint8_t { RED, GREEN, BLUE, WHITE, YELLOW };
+
+// How Live's state for a button changes when it's pressed
+enum Feedback : uint8_t {
+  TOGGLE, // Flips right away (mute, solo, arm, transport)
+  HOST,   // Only Live knows (clip launch waits for quantization)
+};
+
+// What Live can show on a button, as the CC value it sends. Any other nonzero
+// value is LED_ON. Must match the LED_ values in PossumBox.py.
+enum LedState : uint8_t {
+  LED_OFF = 0,
+  LED_QUEUED = 1,    // Clip waiting to start or stop: blinks
+  LED_RECORDING = 2, // Pulses
+  LED_STOPPED = 3,   // Clip just stopped: fades out to LED_OFF
+  LED_ON = 127,      // Playing, muted, armed...
+};
+
+// Colors are balanced by each LED's current, so every color uses the same PWM
+// levels over the whole range. Values are PCA9956 IREF (0-255, ~225 uA per
+// step); they give the same lit brightness as the old PWM-only balance at 0x09.
+constexpr uint8_t colorCurrent[] = {
+  5, // RED
+  4, // GREEN
+  3, // BLUE
+  7, // WHITE
+  7, // YELLOW
+};
+
+// Idle at 117/255 perceived brightness, the old 1/7 of lit in PWM
+constexpr uint8_t LED_LO = ledGamma(117);
+constexpr uint8_t LED_HI = ledGamma(255);
 
 class MuxedButton : public Bounce2::Button {
   public:
@@ -98,10 +441,13 @@ class MuxedButton : public Bounce2::Button {
 
 
 
+// Controls keep their wiring (pins, mux channels, expander pins) public so
+// tools/replay can drive the simulated inputs
 class Input {
   public:
     uint8_t trackInd;
     uint8_t cc;
+    uint8_t channel = MIDI_CHANNEL;
 
     Input(uint8_t trackInd, uint8_t cc) : trackInd(trackInd), cc(cc) {}
 
@@ -109,6 +455,9 @@ class Input {
     virtual void emit() = 0;
     virtual void receive(uint8_t value) = 0;
     virtual void setEnabled(bool enabled) = 0;
+
+    // The same control on chained panel n (1+), or nullptr if it only exists on the main board
+    virtual Input* forPanel(uint8_t panel) { return nullptr; }
 };
 
 
@@ -116,25 +465,51 @@ class Input {
 template <class T>
 class LEDButtonBase: public Input {
   public:
-    LEDButtonBase(uint8_t trackInd, Color color, uint8_t cc, uint8_t pcaInd, uint8_t pcaPin)
-      : Input(trackInd, cc), color(color), pcaInd(pcaInd), pcaPin(pcaPin), btn() {}
+    LEDButtonBase(uint8_t trackInd, Color color, uint8_t cc, uint8_t pcaInd, uint8_t pcaPin, Feedback feedback)
+      : Input(trackInd, cc), color(color), feedback(feedback), pcaInd(pcaInd), pcaPin(pcaPin), btn() {}
 
     void init() override {
-      pcas[pcaInd]->pwmLED(pcaPin, brightness(color));
+      setLEDCurrent(pcaInd, pcaPin, colorCurrent[color]);
+      setLED(pcaInd, pcaPin, LED_LO);
     }
   
     void emit() override {
+      if (this->pending && millis() - this->pendingSince > OPTIMISTIC_TIMEOUT_MS) {
+        // Live never confirmed; show what it last told us
+        this->pending = false;
+        show(this->hostState);
+      }
+
+      if (!this->enabled) {
+        // Read the pin but leave the LED and Live alone
+        if (benchmarking) {
+          this->btn.update();
+        }
+        return;
+      }
       // Buttons act as a momentary toggle in Live; just send 127 if it has been pressed
-      if (this->enabled && this->btn.update() && this->btn.isPressed()) {
-        usbMIDI.sendControlChange(this->cc, 127, MIDI_CHANNEL);
+      if (!this->btn.update()) {
+        return;
+      }
+      TRACE_MIDI(TRACE_BUTTON, this->channel, this->cc, this->btn.isPressed());
+      if (this->btn.isPressed()) {
+        sendCc(this->cc, 127, this->channel);
+        if (OPTIMISTIC_LEDS && this->feedback == Feedback::TOGGLE) {
+          // Predict from the displayed state so quick double presses flip twice
+          this->pending = true;
+          this->pendingSince = millis();
+          show(this->lit ? LED_OFF : LED_ON);
+        }
       }
     }
 
     void receive(uint8_t value) override {
+      this->hostState = value;
+      this->pending = false;
       if (!this->enabled) {
         return;
       }
-      pcas[pcaInd]->pwmLED(pcaPin, value > 0 ? brightness(color) * LED_HI_FACTOR : brightness(color));
+      show(this->hostState);
     }
 
     void setEnabled(bool enabled) override {
@@ -143,12 +518,44 @@ class LEDButtonBase: public Input {
         return;
       }
       this->enabled = enabled;
-      pcas[pcaInd]->pwmLED(pcaPin, enabled ? brightness(color) : 0);
+      this->pending = false;
+      if (enabled) {
+        show(LED_OFF);
+      }
+      else {
+        setLED(pcaInd, pcaPin, 0);
+      }
     }
 
   protected:
+    void show(uint8_t state) {
+      this->lit = state != LED_OFF && state != LED_STOPPED;
+      switch (state) {
+        case LED_OFF:
+          setLED(pcaInd, pcaPin, LED_LO);
+          break;
+        case LED_QUEUED:
+          animateLED(pcaInd, pcaPin, ANIM_BLINK, LED_LO, LED_HI);
+          break;
+        case LED_RECORDING:
+          animateLED(pcaInd, pcaPin, ANIM_PULSE, LED_LO, LED_HI);
+          break;
+        case LED_STOPPED:
+          animateLED(pcaInd, pcaPin, ANIM_FADE, LED_LO, LED_HI);
+          break;
+        default:
+          setLED(pcaInd, pcaPin, LED_HI);
+          break;
+      }
+    }
+
     bool enabled = true;
     Color color;
+    Feedback feedback;
+    bool lit = false;
+    uint8_t hostState = LED_OFF;
+    bool pending = false;
+    uint32_t pendingSince = 0;
     uint8_t pcaInd;
     uint8_t pcaPin;
     T btn;
@@ -157,30 +564,36 @@ class LEDButtonBase: public Input {
 
 class LEDButton : public LEDButtonBase<Bounce2::Button> {
   public:
-    LEDButton(uint8_t trackInd, Color color, uint8_t cc, uint8_t pin, uint8_t pcaInd, uint8_t pcaPin)
-      : LEDButtonBase(trackInd, color, cc, pcaInd, pcaPin), pin(pin) {}
+    LEDButton(uint8_t trackInd, Color color, uint8_t cc, uint8_t pin, uint8_t pcaInd, uint8_t pcaPin, Feedback feedback = Feedback::TOGGLE)
+      : LEDButtonBase(trackInd, color, cc, pcaInd, pcaPin, feedback), pin(pin) {}
 
     void init() override {
       this->btn.attach(pin, INPUT_PULLUP);
       LEDButtonBase::init();
     }
 
-  private:
     uint8_t pin;
 };
 
 
 class LEDMuxedButton : public LEDButtonBase<MuxedButton> {
   public:
-    LEDMuxedButton(uint8_t trackInd, Color color, uint8_t cc, uint8_t mcpInd, uint8_t mcpPin, uint8_t pcaInd, uint8_t pcaPin)
-      : LEDButtonBase(trackInd, color, BUTTON_CC_BASE + cc, pcaInd, pcaPin), mcpInd(mcpInd), mcpPin(mcpPin) {}
+    LEDMuxedButton(uint8_t trackInd, Color color, uint8_t cc, uint8_t mcpInd, uint8_t mcpPin, uint8_t pcaInd, uint8_t pcaPin, Feedback feedback = Feedback::TOGGLE)
+      : LEDButtonBase(trackInd, color, BUTTON_CC_BASE + cc, pcaInd, pcaPin, feedback), mcpInd(mcpInd), mcpPin(mcpPin) {}
     
     void init() override {
       this->btn.init(mcps[mcpInd], this->mcpPin);
       LEDButtonBase::init();
     }
-    
-  private:
+
+    Input* forPanel(uint8_t panel) override {
+      LEDMuxedButton* b = new LEDMuxedButton(
+        trackInd + panel * PANEL_TRACKS, color, cc - BUTTON_CC_BASE,
+        mcpInd + panel * 2, mcpPin, pcaInd + panel * 2, pcaPin, feedback);
+      b->channel = MIDI_CHANNEL + panel;
+      return b;
+    }
+
     uint8_t mcpInd;
     uint8_t mcpPin;
 };
@@ -188,51 +601,200 @@ class LEDMuxedButton : public LEDButtonBase<MuxedButton> {
 
 class Pot : public Input {
   public:
-    Pot(uint8_t trackInd, uint8_t cc, uint8_t adcPin)
-      : Input(trackInd, cc), reader(adcPin, false) {}
+    Pot(uint8_t trackInd, uint8_t cc, uint8_t adcPin, uint8_t highResCc)
+      : Input(trackInd, POT_HIGH_RES ? highResCc : cc), adcPin(adcPin), reader(adcPin, false) {
+      if (POT_HIGH_RES) {
+        this->channel = POT_HIGH_RES_CHANNEL;
+      }
+      reader.setAnalogResolution(ADC_MAX + 1);
+    }
     
 
     void init() override {}
-    void receive(uint8_t value) override {}
+
+    void receive(uint8_t value) override {
+      // Live's value is 7 bit (the MSB in high res mode)
+      this->hostValue = POT_HIGH_RES ? (value << 7) + 64 : value;
+      if (POT_TAKEOVER && millis() - this->lastSendMs > POT_ECHO_MS
+          && abs(this->hostValue - this->lastValue) > (POT_HIGH_RES ? 128 : minChangeToSend)) {
+        this->pickedUp = false;
+      }
+    }
 
     void emit() override {
       reader.update();
+      if (reader.hasChanged()) {
+        TRACE_MIDI(TRACE_POT, this->channel, this->cc, reader.getValue());
+      }
 
-      int value = constrain(this->reader.getValue(), 0, 1023) / 8;
+      int reading = constrain(this->reader.getValue(), 0, ADC_MAX);
+      int value = POT_HIGH_RES ? reading << (14 - ADC_BITS) : reading >> (ADC_BITS - 7);
       if (abs(value - this->lastValue) <= minChangeToSend) {
         return;
       }
-      usbMIDI.sendControlChange(this->cc, value, MIDI_CHANNEL);
+      // Live's MSB is its own value, not our last one, after a pickup
+      bool sendMsb = (value >> 7) != (this->lastValue >> 7);
+      if (!this->pickedUp) {
+        // Picked up once the knob has moved onto or past Live's value
+        bool crossed = (this->lastValue - this->hostValue) * (value - this->hostValue) <= 0;
+        this->lastValue = value;
+        if (!crossed) {
+          return;
+        }
+        this->pickedUp = true;
+        sendMsb = true;
+      }
+      if (POT_HIGH_RES) {
+        // A lone LSB updates the low bits of the MSB the receiver already has
+        if (sendMsb) {
+          sendCc(this->cc, value >> 7, this->channel);
+        }
+        sendCc(this->cc + 32, value & 0x7F, this->channel);
+      }
+      else {
+        sendCc(this->cc, value);
+      }
       this->lastValue = value;
+      this->lastSendMs = millis();
     }
 
     void setEnabled(bool enabled) override {}
-  
+
+    uint8_t adcPin;
+
   private:
-    int lastValue;
+    int lastValue = 0;
+    int hostValue = 0;
+    bool pickedUp = true;
+    uint32_t lastSendMs = 0;
     ResponsiveAnalogRead reader;
 
-    static const int minChangeToSend = 2;
+    // In units of the value sent; 2 ADC counts at 14 bits
+    static const int minChangeToSend = POT_HIGH_RES ? 2 << (14 - ADC_BITS) : 2;
+};
+
+
+class Joystick : public Input {
+  // Both axes are read back to back and treated as one 2D position, with a
+  // radial deadzone so diagonal moves don't snap to an axis. It isn't part of
+  // the control scan; emit() is called between controls and only samples once
+  // every JOYSTICK_SAMPLE_US.
+  public:
+    Joystick(uint8_t trackInd, uint8_t ccX, uint8_t ccY, uint8_t pinX, uint8_t pinY, bool highRes)
+      : Input(trackInd, highRes ? JOYSTICK_HIGH_RES_X_CC : ccX),
+        ccY(highRes ? JOYSTICK_HIGH_RES_Y_CC : ccY), pinX(pinX), pinY(pinY), highRes(highRes) {
+      if (highRes) {
+        this->channel = JOYSTICK_HIGH_RES_CHANNEL;
+      }
+    }
+
+    void init() override {
+      // Calibrate center; the stick must be at rest at power on
+      long sumX = 0, sumY = 0;
+      for (int i = 0; i < 16; i++) {
+        sumX += analogRead(pinX);
+        sumY += analogRead(pinY);
+      }
+      centerX = constrain(sumX / 16, 1, ADC_MAX - 1);
+      centerY = constrain(sumY / 16, 1, ADC_MAX - 1);
+      nextSampleUs = micros();
+    }
+
+    void receive(uint8_t value) override {}
+    void setEnabled(bool enabled) override {}
+
+    void emit() override {
+      if ((int32_t)(micros() - nextSampleUs) < 0) {
+        return;
+      }
+      nextSampleUs += JOYSTICK_SAMPLE_US;
+      if ((int32_t)(micros() - nextSampleUs) > 0) {
+        // Fell more than a period behind (e.g. a long I2C burst); don't try to catch up
+        nextSampleUs = micros() + JOYSTICK_SAMPLE_US;
+      }
+
+      int rawX = analogRead(pinX);
+      int rawY = analogRead(pinY);
+      int32_t x = normalize(rawX, centerX);
+      int32_t y = normalize(rawY, centerY);
+
+      uint32_t r = isqrt(x * x + y * y);
+      if (r <= JOYSTICK_DEADZONE) {
+        x = y = 0;
+      }
+      else {
+        // Rescale so the output starts from 0 at the edge of the deadzone
+        int32_t scaled = (int32_t)(r - JOYSTICK_DEADZONE) * 8192 / (8192 - JOYSTICK_DEADZONE);
+        x = x * scaled / (int32_t)r;
+        y = y * scaled / (int32_t)r;
+      }
+
+      if (send(this->cc, constrain(x + 8192, 0, 16383), lastX)) {
+        TRACE_MIDI(TRACE_POT, this->channel, this->cc, rawX);
+      }
+      if (send(ccY, constrain(y + 8192, 0, 16383), lastY)) {
+        TRACE_MIDI(TRACE_POT, this->channel, ccY, rawY);
+      }
+    }
+
+    uint8_t ccY;
+    uint8_t pinX;
+    uint8_t pinY;
+
+  private:
+    // -8192 to 8191, 0 at the calibrated center. Each side of center is scaled
+    // separately since the center is rarely at exactly half range.
+    int32_t normalize(int raw, int center) {
+      int32_t d = raw - center;
+      return d >= 0 ? d * 8191 / (ADC_MAX - center) : d * 8192 / center;
+    }
+
+    bool send(uint8_t cc, int value, int& last) {
+      if (abs(value - last) < JOYSTICK_MIN_CHANGE) {
+        return false;
+      }
+      if (highRes) {
+        // A lone LSB updates the low bits of the MSB the receiver already has
+        if ((value >> 7) != (last >> 7)) {
+          sendCc(cc, value >> 7, this->channel);
+        }
+        sendCc(cc + 32, value & 0x7F, this->channel);
+      }
+      else if ((value >> 7) != (last >> 7)) {
+        sendCc(cc, value >> 7);
+      }
+      else {
+        return false;
+      }
+      last = value;
+      return true;
+    }
+
+    bool highRes;
+    int centerX = (ADC_MAX + 1) / 2;
+    int centerY = (ADC_MAX + 1) / 2;
+    int lastX = -JOYSTICK_MIN_CHANGE;
+    int lastY = -JOYSTICK_MIN_CHANGE;
+    uint32_t nextSampleUs = 0;
 };
 
 
 class MuxedPot : public Pot {
   public:
     MuxedPot(uint8_t trackInd, uint8_t cc, uint8_t adcPin, int muxChannel)
-      : Pot(trackInd, POT_CC_BASE + cc, adcPin), muxChannel(muxChannel) {}
+      : Pot(trackInd, POT_CC_BASE + cc, adcPin, POT_HIGH_RES_CC_BASE + cc), muxChannel(muxChannel) {}
 
     void emit() override {
       mux.channel(muxChannel);
       Pot::emit();
     }
 
-  private:
     int muxChannel;
 };
 
 
 
-Input* controls[] = {
+Input* builtinControls[] = {
   // U1 0x04 / U3 0x0B
   new LEDMuxedButton(8, Color::BLUE, 0, 0, 0, 0, 19),  // S8
   new LEDMuxedButton(8, Color::YELLOW, 1, 0, 1, 0, 18),  // M8
@@ -254,114 +816,378 @@ Input* controls[] = {
   // U2 0x06 / U4 0x0D
   new LEDMuxedButton(8, Color::RED, 16, 1, 0, 1, 23), // R8
   // NOTE/FIXME: P8 should be green, but I ran out
-  new LEDMuxedButton(8, Color::WHITE, 17, 1, 1, 1, 22), // P8
+  new LEDMuxedButton(8, Color::WHITE, 17, 1, 1, 1, 22, Feedback::HOST), // P8
   new LEDMuxedButton(7, Color::RED, 18, 1, 2, 1, 21), // R7
-  new LEDMuxedButton(7, Color::GREEN, 19, 1, 3, 1, 20), // P7
+  new LEDMuxedButton(7, Color::GREEN, 19, 1, 3, 1, 20, Feedback::HOST), // P7
   new LEDMuxedButton(6, Color::RED, 20, 1, 4, 1, 19), // R6
-  new LEDMuxedButton(6, Color::GREEN, 21, 1, 5, 1, 18), // P6
+  new LEDMuxedButton(6, Color::GREEN, 21, 1, 5, 1, 18, Feedback::HOST), // P6
   new LEDMuxedButton(5, Color::RED, 22, 1, 6, 1, 17), // R5
-  new LEDMuxedButton(5, Color::GREEN, 23, 1, 7, 1, 16), // P5
+  new LEDMuxedButton(5, Color::GREEN, 23, 1, 7, 1, 16, Feedback::HOST), // P5
   new LEDMuxedButton(4, Color::RED, 24, 1, 8, 1, 7),  // R4
-  new LEDMuxedButton(4, Color::GREEN, 25, 1, 9, 1, 6),  // P4
+  new LEDMuxedButton(4, Color::GREEN, 25, 1, 9, 1, 6, Feedback::HOST),  // P4
   new LEDMuxedButton(3, Color::RED, 26, 1, 10, 1, 5), // R3
-  new LEDMuxedButton(3, Color::GREEN, 27, 1, 11, 1, 4), // P3
+  new LEDMuxedButton(3, Color::GREEN, 27, 1, 11, 1, 4, Feedback::HOST), // P3
   new LEDMuxedButton(2, Color::RED, 28, 1, 12, 1, 3), // R2
-  new LEDMuxedButton(2, Color::GREEN, 29, 1, 13, 1, 2), // P2
+  new LEDMuxedButton(2, Color::GREEN, 29, 1, 13, 1, 2, Feedback::HOST), // P2
   new LEDMuxedButton(1, Color::RED, 30, 1, 14, 1, 1), // R1
-  new LEDMuxedButton(1, Color::GREEN, 31, 1, 15, 1, 0), // P1
+  new LEDMuxedButton(1, Color::GREEN, 31, 1, 15, 1, 0, Feedback::HOST), // P1
 
   // U5 / A8 ("ADC0")
-  new MuxedPot(1, 0, A8, 5), // G1
-  new MuxedPot(2, 1, A8, 7), // G2
-  new MuxedPot(3, 2, A8, 6), // G3
-  new MuxedPot(4, 3, A8, 4), // G4
+  new MuxedPot(1, 0, MUX_ADC_0, 5), // G1
+  new MuxedPot(2, 1, MUX_ADC_0, 7), // G2
+  new MuxedPot(3, 2, MUX_ADC_0, 6), // G3
+  new MuxedPot(4, 3, MUX_ADC_0, 4), // G4
   // U6 / A9 ("ADC1")
-  new MuxedPot(5, 4, A9, 5), // G5
-  new MuxedPot(6, 5, A9, 7), // G6
-  new MuxedPot(7, 6, A9, 6), // G7
-  new MuxedPot(8, 7, A9, 4), // G8
+  new MuxedPot(5, 4, MUX_ADC_1, 5), // G5
+  new MuxedPot(6, 5, MUX_ADC_1, 7), // G6
+  new MuxedPot(7, 6, MUX_ADC_1, 6), // G7
+  new MuxedPot(8, 7, MUX_ADC_1, 4), // G8
 
   // U5 / A8 ("ADC0")
-  new MuxedPot(1, 8, A8, 3), // U1
-  new MuxedPot(2, 9, A8, 0), // U2
-  new MuxedPot(3, 10, A8, 1), // U3
-  new MuxedPot(4, 11, A8, 2), // U4
+  new MuxedPot(1, 8, MUX_ADC_0, 3), // U1
+  new MuxedPot(2, 9, MUX_ADC_0, 0), // U2
+  new MuxedPot(3, 10, MUX_ADC_0, 1), // U3
+  new MuxedPot(4, 11, MUX_ADC_0, 2), // U4
   // U6 / A9 ("ADC1")
-  new MuxedPot(5, 12, A9, 3), // U5
-  new MuxedPot(6, 13, A9, 0), // U6
-  new MuxedPot(7, 14, A9, 1), // U7
-  new MuxedPot(8, 15, A9, 2), // U8
+  new MuxedPot(5, 12, MUX_ADC_1, 3), // U5
+  new MuxedPot(6, 13, MUX_ADC_1, 0), // U6
+  new MuxedPot(7, 14, MUX_ADC_1, 1), // U7
+  new MuxedPot(8, 15, MUX_ADC_1, 2), // U8
 
   // Master controls
   new LEDButton(MASTER_TRACK, Color::RED, MASTER_REC_CC, 12, 1, 13), // R_MASTER
   new LEDButton(MASTER_TRACK, Color::GREEN, MASTER_PLAY_CC, 13, 1, 12), // P_MASTER
-  new Pot(MASTER_TRACK, MASTER_POT_1_CC, A3), // FX_1
-  new Pot(MASTER_TRACK, MASTER_POT_2_CC, A2), // FX_2
-  new Pot(MASTER_TRACK, MASTER_POT_3_CC, A0), // FX_3
-  new Pot(MASTER_TRACK, MASTER_POT_4_CC, A1), // FX_4
-
-  new Pot(MASTER_TRACK, JOYSTICK_X_CC, A6), // Joystick X
-  new Pot(MASTER_TRACK, JOYSTICK_Y_CC, A7), // Joystick Y
+  new Pot(MASTER_TRACK, MASTER_POT_1_CC, A3, MASTER_POT_HIGH_RES_CC_BASE + 0), // FX_1
+  new Pot(MASTER_TRACK, MASTER_POT_2_CC, A2, MASTER_POT_HIGH_RES_CC_BASE + 1), // FX_2
+  new Pot(MASTER_TRACK, MASTER_POT_3_CC, A0, MASTER_POT_HIGH_RES_CC_BASE + 2), // FX_3
+  new Pot(MASTER_TRACK, MASTER_POT_4_CC, A1, MASTER_POT_HIGH_RES_CC_BASE + 3), // FX_4
 };
 
+#define NUM_BUILTIN_CONTROLS (sizeof(builtinControls) / sizeof(builtinControls[0]))
+
+// builtinControls plus the controls of any chained panels
+struct ControlTable {
+  Input* items[NUM_BUILTIN_CONTROLS + MAX_EXTRA_PANELS * PANEL_BUTTONS];
+  uint8_t count = 0;
+
+  void add(Input* c) { items[count++] = c; }
+  Input** begin() { return items; }
+  Input** end() { return items + count; }
+} controls;
+
+Joystick joystick(MASTER_TRACK, JOYSTICK_X_CC, JOYSTICK_Y_CC, A6, A7, JOYSTICK_HIGH_RES);
+
 
 void handleCc(uint8_t channel, uint8_t control, uint8_t value) {
+  TRACE_MIDI(TRACE_CC_IN, channel, control, value);
   for (auto c : controls) { 
     if (control == TRACK_COUNT_CC && value != MASTER_TRACK) {
       c->setEnabled(c->trackInd <= value);
     }
-    else if (c->cc == control) {
+    else if (c->cc == control && c->channel == channel) {
       c->receive(value);
     }
   }
 }
 
 
+void scanControls() {
+  for (auto c : controls) {
+    c->emit();
+    joystick.emit();
+    flushLEDs(LED_WRITES_PER_SLOT);
+  }
+}
+
+
+// Measures this unit's I/O costs and replies with one SysEx message, so scan
+// rates can be tuned per unit (cable length and pull-ups vary). Payload, little
+// endian, decoded by tools/bench_decode.py:
+//   u8 version (3)
+//   u8 clock count, u16 kHz per clock
+//   u8 PCA count, per PCA: u16 us per LED write at each clock (0xFFFF = writes failed)
+//   u8 MCP count, per MCP: u16 us single pin read, u16 us full port read (at I2C_CLOCK)
+//   u8 ADC count, per mux channel of A8 then A9: u8 us conversion, u8 us mux settle (255 = didn't settle)
+//   u32 us per loop() pass, polling every control
+//   u16 free RAM
+void loop();
+bool benchmarkRequested = false;
+
+void runBenchmark() {
+  benchmarking = true;
+  const uint32_t clocks[] = BENCHMARK_CLOCKS;
+  const uint8_t numClocks = sizeof(clocks) / sizeof(clocks[0]);
+  const uint8_t adcPins[] = { MUX_ADC_0, MUX_ADC_1 };
+  const uint8_t settleSteps[] = { 0, 2, 5, 10, 20, 50, 100, 200 };
+
+  uint8_t out[SYSEX_MAX_PAYLOAD];
+  uint16_t n = 0;
+  auto put16 = [&](uint16_t v) { out[n++] = v & 0xFF; out[n++] = v >> 8; };
+
+  out[n++] = 3;
+
+  out[n++] = numClocks;
+  for (uint8_t k = 0; k < numClocks; k++) {
+    put16(clocks[k] / 1000);
+  }
+
+  // Rewrite every LED's current level, so nothing visibly changes. A clock the
+  // bus can't hold (e.g. pull-ups too weak for it) fails writes; its time means
+  // nothing then.
+  out[n++] = numPcas;
+  for (uint8_t pcaInd = 0; pcaInd < numPcas; pcaInd++) {
+    for (uint8_t k = 0; k < numClocks; k++) {
+      PCA_BUS.setClock(clocks[k]);
+      uint8_t failed = 0;
+      uint32_t start = micros();
+      for (uint8_t pin = 0; pin < PCA9965_NUM_LEDS; pin++) {
+        if (pwmLED(pcaInd, pin, ledLevel[pcaInd][pin])) {
+          failed++;
+        }
+      }
+      uint32_t us = (micros() - start) / PCA9965_NUM_LEDS;
+      put16(failed ? 0xFFFF : us);
+    }
+  }
+  PCA_BUS.setClock(I2C_CLOCK);
+  // Failed writes may have left levels on the chips other than ledLevel's, so
+  // write them all again at the normal clock (before loop() is timed below)
+  for (uint8_t pcaInd = 0; pcaInd < numPcas; pcaInd++) {
+    ledDirty[pcaInd] = (1UL << PCA9965_NUM_LEDS) - 1;
+  }
+  flushLEDs(numPcas * PCA9965_NUM_LEDS);
+
+  uint8_t numMcps = numPanels * 2;
+  out[n++] = numMcps;
+  for (uint8_t i = 0; i < numMcps; i++) {
+    uint32_t start = micros();
+    mcps[i]->digitalRead(0);
+    put16(micros() - start);
+    start = micros();
+    mcps[i]->readGPIOAB();
+    put16(micros() - start);
+  }
+
+  out[n++] = sizeof(adcPins) * 8;
+  for (uint8_t pin : adcPins) {
+    for (uint8_t ch = 0; ch < 8; ch++) {
+      mux.channel(ch);
+      delayMicroseconds(200);
+      uint32_t start = micros();
+      int settled = analogRead(pin);
+      uint32_t convUs = micros() - start;
+      out[n++] = convUs > 255 ? 255 : convUs;
+
+      // Shortest wait after switching over from the neighbouring channel
+      // that reads the same as a fully settled reading
+      uint8_t settle = 255;
+      for (uint8_t wait : settleSteps) {
+        mux.channel((ch + 1) % 8);
+        delayMicroseconds(200);
+        mux.channel(ch);
+        delayMicroseconds(wait);
+        if (abs(analogRead(pin) - settled) <= 8) {
+          settle = wait;
+          break;
+        }
+      }
+      out[n++] = settle;
+    }
+  }
+
+  // The whole loop as it runs on stage with every track in use: MIDI and
+  // serial input, the scan, animations, log draining and the delay
+  const uint8_t loops = 16;
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < loops; i++) {
+    loop();
+  }
+  uint32_t loopUs = (micros() - start) / loops;
+  for (uint8_t i = 0; i < 4; i++) {
+    out[n++] = (loopUs >> (i * 8)) & 0xFF;
+  }
+
+  put16(freeRam());
+
+  sysexSend(SYSEX_BENCHMARK, 0, out, n);
+  benchmarking = false;
+}
+
+
+void handleSysEx(uint8_t* data, unsigned int size) {
+  switch (sysexCommand(data, size)) {
+    case SYSEX_BENCHMARK:
+      // Run from loop(), since it times loop() and that reads MIDI input
+      benchmarkRequested = true;
+      break;
+    case SYSEX_PANEL_COUNT:
+      sysexSend(SYSEX_PANEL_COUNT, 0, &numPanels, 1);
+      break;
+#ifdef POSSUM_TRACE
+    case SYSEX_TRACE_DUMP:
+      trace.dumpSysEx();
+      break;
+    case SYSEX_TRACE_CLEAR:
+      trace.clear();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+
+void handleSerial(int command) {
+  switch (command) {
+#ifdef POSSUM_TRACE
+    case 'T':
+      // Binary trace dump, see Trace.h for the layout
+      trace.dump(Serial);
+      Serial.flush();
+      break;
+    case 'C':
+      trace.clear();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+
+// Heap a chained panel takes: its button clones (see forPanel()), expanders and
+// LED drivers, each its own block with malloc's 8 byte overhead
+constexpr int PANEL_BUTTONS_HEAP_BYTES = PANEL_BUTTONS * (sizeof(LEDMuxedButton) + 8);
+constexpr int PANEL_HEAP_BYTES = PANEL_BUTTONS_HEAP_BYTES
+  + 2 * (sizeof(Adafruit_MCP23017) + 8) + 2 * (sizeof(PCA9956) + 8);
+
+// One pass over the MCP23017 range, then the PCA9956 range only until every
+// extra pair of expanders has a pair of LED drivers, so boot doesn't pay for
+// probing addresses no panel uses. Extra chips pair up in address order.
+void discoverPanels() {
+  uint8_t found[MAX_MCPS];
+  uint8_t extraMcps[MAX_MCPS];
+  uint8_t numExtraMcps = 0;
+  uint8_t n = i2cScanRange(&MCP_BUS, MCP_SCAN_FIRST, MCP_SCAN_LAST, found, MAX_MCPS);
+  for (uint8_t i = 0; i < n && numExtraMcps < MAX_EXTRA_PANELS * 2; i++) {
+    uint8_t addr = found[i] & 0x07;
+    if (addr != MCP_ADDR_1 && addr != MCP_ADDR_2) {
+      extraMcps[numExtraMcps++] = addr;
+    }
+  }
+  if (numExtraMcps < 2) {
+    return;
+  }
+
+  uint8_t extraPcaAddrs[MAX_PCAS - 2];
+  uint8_t numExtraPcas = 0;
+  uint8_t addr = PCA_SCAN_FIRST;
+  while (numExtraPcas < (numExtraMcps & ~1) && addr <= PCA_SCAN_LAST) {
+    if (!i2cScanRange(&PCA_BUS, addr, PCA_SCAN_LAST, found, 1)) {
+      break;
+    }
+    addr = found[0] + 1;
+    bool isMcp = found[0] >= MCP_SCAN_FIRST && found[0] <= MCP_SCAN_LAST;
+    if (found[0] != PCA_ADDR_1 && found[0] != PCA_ADDR_2 && !isMcp) {
+      extraPcaAddrs[numExtraPcas++] = found[0];
+    }
+  }
+
+  for (uint8_t panel = 1; panel * 2 <= numExtraPcas; panel++) {
+    // Panels already taken have their chips but not yet their buttons, which
+    // setup() clones once discovery is done
+    int available = freeRam() - (panel - 1) * PANEL_BUTTONS_HEAP_BYTES;
+    if (available < PANEL_HEAP_BYTES + MIN_FREE_RAM) {
+      LOG(LOG_PANEL_NO_RAM, panel, available > 0 ? available : 0);
+      break;
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+      uint8_t ind = (panel - 1) * 2 + i;
+      Adafruit_MCP23017* mcp = new Adafruit_MCP23017();
+      mcp->begin(extraMcps[ind], &MCP_BUS);
+      mcps[panel * 2 + i] = mcp;
+
+      extraPcas[ind] = new PCA9956(&PCA_BUS);
+      extraPcas[ind]->init(extraPcaAddrs[ind], 0x09, true);
+    }
+    LOG(LOG_PANEL_FOUND, panel, extraPcaAddrs[(panel - 1) * 2], extraPcaAddrs[(panel - 1) * 2 + 1]);
+    numPcas += 2;
+    numPanels++;
+  }
+}
+
+
 void setup() {
   Serial.begin(9600);
 
   // while (!Serial && millis() < 5000) {}
   // delay(500);
 
-  Serial.printf("Init (%d bytes free)\n", freeRam());
-  Wire.begin();
+  LOG(LOG_BOOT, freeRam());
+  analogReadResolution(ADC_BITS);
+  analogReadAveraging(ADC_AVERAGING);
+  // Harmless to begin() the same bus twice when both groups share it
+  MCP_BUS.begin();
+  PCA_BUS.begin();
+  MCP_BUS.setClock(I2C_CLOCK);
+  PCA_BUS.setClock(I2C_CLOCK);
 
-  mcp1.begin(MCP_ADDR_1);
-  mcp2.begin(MCP_ADDR_2);
+  mcp1.begin(MCP_ADDR_1, &MCP_BUS);
+  mcp2.begin(MCP_ADDR_2, &MCP_BUS);
 
-  pca1.init(PCA_ADDR_1, 0x09, true);
-  pca2.init(PCA_ADDR_2, 0x09, true);
+  pca1.init(0x09);
+  pca2.init(0x09);
+
+  discoverPanels();
+  for (auto c : builtinControls) {
+    controls.add(c);
+  }
+  for (uint8_t panel = 1; panel < numPanels; panel++) {
+    for (auto c : builtinControls) {
+      Input* panelControl = c->forPanel(panel);
+      if (panelControl) {
+        controls.add(panelControl);
+      }
+    }
+  }
 
   usbMIDI.setHandleControlChange(handleCc);
+  usbMIDI.setHandleSystemExclusive(handleSysEx);
 
   for (auto c : controls) {
     c->init();
   }
+  joystick.init();
+  flushLEDs(numPcas * PCA9965_NUM_LEDS);
 
-  Serial.printf("Init complete (%d bytes free)\n", freeRam());
+  LOG(LOG_INIT_DONE, numPanels, freeRam());
 }
 
 
 void loop() {
+  uint32_t loopStart = micros();
+
   while(usbMIDI.read()) {}
+  while(Serial.available()) {
+    handleSerial(Serial.read());
+  }
 
-  for (auto c : controls) {
-    c->emit();
+  scanControls();
+  animateLEDs();
+
+  uint32_t loopUs = micros() - loopStart;
+  if (loopUs > SLOW_LOOP_US) {
+    LOG(LOG_SLOW_LOOP, loopUs > 65535 ? 65535 : loopUs);
   }
 
+#ifdef POSSUM_LOG
+  binlog.drain(Serial);
+#endif
+
   delay(1);
 
-  // Serial.println("-------------");
-  // Serial.print(pca1.readRegisterStatus(MODE2), BIN);
-  // Serial.println("");
-  // Serial.print(pca2.readRegisterStatus(MODE2), BIN);
-  // Serial.println("");
-  // for (int i = 0; i < 6; i++) {
-  //   Serial.printf(" Group %d (LED%d-):  ", i, i * 4);
-  //   Serial.print(pca1.getLEDErrorStatus(ERROR_LED0_3 + i), BIN);
-  //   Serial.print("  /  ");
-  //   Serial.println(pca2.getLEDErrorStatus(ERROR_LED0_3 + i), BIN);
-  // }
-  // Serial.println("");
-  // Serial.println("");
+  if (benchmarkRequested && !benchmarking) {
+    benchmarkRequested = false;
+    runBenchmark();
+  }
 }
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Print the reply to the controller's self-benchmark (runBenchmark() in
+src/main.cpp), recorded as a .syx file after sending F0 7D 03 F7:
+    bench_decode.py bench.syx
+
+The figures are per unit, so compare them before raising I2C_CLOCK or
+shortening the mux settle time on a given box.
+"""
+from __future__ import print_function
+import struct
+import sys
+
+from trace_capture import SYSEX_MANUFACTURER_ID, unpack7
+
+SYSEX_BENCHMARK = 0x03
+VERSION = 3
+
+
+class Reader(object):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, fmt):
+        fmt = '<' + fmt
+        values = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += struct.calcsize(fmt)
+        return values if len(values) > 1 else values[0]
+
+
+def payload(raw):
+    for msg in raw.split(b'\xf0')[1:]:
+        msg = msg.split(b'\xf7')[0]
+        if len(msg) >= 3 and msg[0] == SYSEX_MANUFACTURER_ID and msg[1] == SYSEX_BENCHMARK:
+            return unpack7(bytearray(msg[3:]))
+    raise SystemExit('no benchmark reply in file')
+
+
+def us(value):
+    # 0xFFFF: some writes failed at this clock, so there's no time to show
+    return 'failed' if value == 0xFFFF else value
+
+
+def report(data, out=sys.stdout):
+    r = Reader(data)
+    version = r.read('B')
+    if version != VERSION:
+        raise SystemExit('unknown benchmark version %d' % version)
+
+    clocks = [r.read('H') for _ in range(r.read('B'))]
+    print('LED write (us), by I2C clock:', file=out)
+    print('  PCA   ' + ''.join('%8d kHz' % k for k in clocks), file=out)
+    for pca in range(r.read('B')):
+        print('  %-6d' % pca + ''.join('%12s' % us(r.read('H')) for _ in clocks), file=out)
+
+    print('Expander read (us):', file=out)
+    print('  MCP   one pin   both ports', file=out)
+    for mcp in range(r.read('B')):
+        print('  %-6d%7d%13d' % ((mcp,) + r.read('HH')), file=out)
+
+    print('ADC (us):', file=out)
+    print('  pin/ch   convert   mux settle', file=out)
+    for i in range(r.read('B')):
+        convert, settle = r.read('BB')
+        print('  A%d/%d %10d   %10s' % (8 + i // 8, i % 8, convert,
+                                         '>200' if settle == 255 else settle), file=out)
+
+    print('Loop: %d us per pass' % r.read('I'), file=out)
+    print('Free RAM: %d bytes' % r.read('H'), file=out)
+
+
+def main(argv):
+    if len(argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    with open(argv[1], 'rb') as f:
+        report(payload(f.read()))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
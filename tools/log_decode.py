@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Decode the firmware's binary log records (lib/BinLog) into text.
+
+    log_decode.py /dev/ttyACM0       live from the USB serial port (needs pyserial)
+    log_decode.py capture.bin        from a saved capture
+    log_decode.py -                  from stdin
+
+Event names and formats come straight from lib/BinLog/LogEvents.h, so they
+always match the firmware built from the same tree. Bytes outside log frames
+(e.g. a trace dump) are skipped.
+"""
+from __future__ import print_function
+import os
+import re
+import struct
+import sys
+
+SYNC = b'\xa5\x5a'
+RECORD = struct.Struct('<IBBHHH')
+EVENTS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'lib', 'BinLog', 'LogEvents.h')
+
+
+def load_events(path=EVENTS_H):
+    events = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'\s*LOG_EVENT\((\w+),\s*"(.*)"\)', line)
+            if m:
+                events[len(events) + 1] = (m.group(1), m.group(2))
+    return events
+
+
+def format_record(events, data):
+    time, event_id, _, a, b, c = RECORD.unpack(data)
+    name, fmt = events.get(event_id, ('LOG_%d' % event_id, 'args %u %u %u'))
+    nargs = len(re.findall(r'%[^%]', fmt))
+    return '%10.3f ms  %s' % (time / 1000.0, fmt % (a, b, c)[:nargs])
+
+
+def decode(stream, events, out=sys.stdout):
+    buf = b''
+    while True:
+        if hasattr(stream, 'in_waiting'):
+            chunk = stream.read(max(1, stream.in_waiting))
+        else:
+            chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf = buf[-1:]
+                break
+            end = start + len(SYNC) + RECORD.size
+            if len(buf) < end:
+                buf = buf[start:]
+                break
+            print(format_record(events, buf[start + len(SYNC):end]), file=out)
+            out.flush()
+            buf = buf[end:]
+
+
+def main(argv):
+    if len(argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    events = load_events()
+    source = argv[1]
+    if source == '-':
+        decode(getattr(sys.stdin, 'buffer', sys.stdin), events)
+    elif source.startswith('/dev/') or source.upper().startswith('COM'):
+        import serial
+        with serial.Serial(source) as s:
+            decode(s, events)
+    else:
+        with open(source, 'rb') as f:
+            decode(f, events)
+    return 0
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main(sys.argv))
+    except KeyboardInterrupt:
+        pass
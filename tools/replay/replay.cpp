@@ -0,0 +1,288 @@
+// Host-side replay of a trace dumped by the firmware (see lib/Trace/Trace.h).
+//
+// The firmware in src/main.cpp and lib/ is compiled natively against the stubs
+// in stubs/ and driven through the recorded inputs one at a time. For each input
+// the report shows the host CPU time spent in loop() (compare between firmware
+// revisions built on the same machine), the modelled on-device latency until the
+// first output (CC or LED write), and the latency the device actually recorded.
+//
+//   make && ./replay trace.bin [--events] [--panels n]
+//
+// --bench out.syx runs the SysEx self-benchmark against the model instead and
+// writes its reply, for checking tools/bench_decode.py without a device.
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "sim.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <Bounce2.h>
+#include <ResponsiveAnalogRead.h>
+#include <Adafruit_MCP23017.h>
+#include <Mux.h>
+#include <PCA9956.h>
+#include <PossumSysEx.h>
+#include <Trace.h>
+
+#include "../../src/main.cpp"
+
+// Loop iterations to wait for an input to produce output (buttons need the debounce interval)
+#define MAX_LOOPS_PER_EVENT 50
+// Bounce2's default interval
+#define BUTTON_DEBOUNCE_US 10000
+
+struct Stats {
+  uint32_t events = 0;
+  uint32_t withOutput = 0;
+  double hostUsTotal = 0;
+  double hostUsMax = 0;
+  double latencyUsTotal = 0;
+  double latencyUsMax = 0;
+  uint32_t recorded = 0;
+  double recordedUsTotal = 0;
+  double recordedUsMax = 0;
+  uint32_t outputs = 0;
+};
+
+static const char* typeName(uint8_t type) {
+  switch (TRACE_TYPE(type)) {
+    case TRACE_BUTTON: return "button";
+    case TRACE_POT: return "pot";
+    case TRACE_CC_IN: return "cc in";
+    case TRACE_CC_OUT: return "cc out";
+    case TRACE_I2C: return "i2c";
+    default: return "?";
+  }
+}
+
+static bool isInput(uint8_t type) {
+  type = TRACE_TYPE(type);
+  return type == TRACE_BUTTON || type == TRACE_POT || type == TRACE_CC_IN;
+}
+
+static Input* findControl(uint8_t cc, uint8_t channel) {
+  for (auto c : controls) {
+    if (c->cc == cc && c->channel == channel) {
+      return c;
+    }
+  }
+  return nullptr;
+}
+
+// Sets the simulated hardware so the control reads the traced value
+static bool applyInput(const TraceRecord& r) {
+  uint8_t type = TRACE_TYPE(r.type);
+  uint8_t channel = TRACE_CHANNEL(r.type);
+  if (type == TRACE_CC_IN) {
+    sim.midiIn.push_back({(uint8_t)(0xB0 | (channel - 1)), r.id, (uint8_t)r.value});
+    return true;
+  }
+
+  if (type == TRACE_POT && channel == joystick.channel && (r.id == joystick.cc || r.id == joystick.ccY)) {
+    uint8_t pin = r.id == joystick.cc ? joystick.pinX : joystick.pinY;
+    for (int ch = 0; ch < SIM_MUX_CHANNELS; ch++) {
+      sim.analog[pin][ch] = r.value;
+    }
+    return true;
+  }
+
+  Input* c = findControl(r.id, channel);
+  if (auto b = dynamic_cast<LEDMuxedButton*>(c)) {
+    uint8_t addr = mcps[b->mcpInd]->address & 7;
+    uint16_t bit = 1 << b->mcpPin;
+    sim.mcpPins[addr] = r.value ? sim.mcpPins[addr] & ~bit : sim.mcpPins[addr] | bit;
+    return true;
+  }
+  if (auto b = dynamic_cast<LEDButton*>(c)) {
+    sim.digital[b->pin] = r.value ? LOW : HIGH;
+    return true;
+  }
+  if (auto p = dynamic_cast<MuxedPot*>(c)) {
+    sim.analog[p->adcPin][p->muxChannel] = r.value;
+    return true;
+  }
+  if (auto p = dynamic_cast<Pot*>(c)) {
+    for (int ch = 0; ch < SIM_MUX_CHANNELS; ch++) {
+      sim.analog[p->adcPin][ch] = r.value;
+    }
+    return true;
+  }
+  return false;
+}
+
+static bool load(const char* path, std::vector<TraceRecord>& records) {
+  std::ifstream in(path, std::ios::binary);
+  TraceHeader h;
+  if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || memcmp(h.magic, "PTRC", 4) != 0) {
+    fprintf(stderr, "%s: not a trace dump\n", path);
+    return false;
+  }
+  if (h.version != TRACE_VERSION) {
+    fprintf(stderr, "%s: trace version %d, expected %d\n", path, h.version, TRACE_VERSION);
+    return false;
+  }
+  records.resize(h.count);
+  if (!in.read(reinterpret_cast<char*>(records.data()), h.count * sizeof(TraceRecord))) {
+    fprintf(stderr, "%s: truncated (expected %d records)\n", path, h.count);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  const char* benchPath = nullptr;
+  bool printEvents = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--events") == 0) {
+      printEvents = true;
+    }
+    else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      benchPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--panels") == 0 && i + 1 < argc) {
+      // Chain extra panels at the next free expander and LED driver addresses
+      int extra = atoi(argv[++i]) - 1;
+      uint8_t mcpAddr = MCP_SCAN_FIRST;
+      uint8_t pcaAddr = 0x10;
+      for (int n = 0; n < extra * 2; n++) {
+        while (mcpAddr <= MCP_SCAN_LAST && sim.i2cPresent[mcpAddr]) {
+          mcpAddr++;
+        }
+        while (sim.i2cPresent[pcaAddr]) {
+          pcaAddr++;
+        }
+        if (mcpAddr > MCP_SCAN_LAST) {
+          fprintf(stderr, "--panels: only room for %d expanders\n", n);
+          return 2;
+        }
+        sim.i2cPresent[mcpAddr] = sim.i2cPresent[pcaAddr] = true;
+      }
+    }
+    else {
+      path = argv[i];
+    }
+  }
+  if (benchPath) {
+    setup();
+    sim.sysexOut.clear();
+    benchmarkRequested = true;
+    loop();
+    std::ofstream out(benchPath, std::ios::binary);
+    for (auto& msg : sim.sysexOut) {
+      out.write(reinterpret_cast<const char*>(msg.data()), msg.size());
+    }
+    return out ? 0 : 1;
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s trace.bin [--events] [--panels n] | --bench out.syx [--panels n]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<TraceRecord> records;
+  if (!load(path, records)) {
+    return 1;
+  }
+
+  setup();
+  for (int i = 0; i < MAX_LOOPS_PER_EVENT; i++) {
+    loop();
+  }
+
+  std::map<uint8_t, Stats> stats;
+  bool started = false;
+  int64_t traceToSimUs = 0;
+  for (size_t i = 0; i < records.size(); i++) {
+    const TraceRecord& r = records[i];
+    if (!isInput(r.type)) {
+      continue;
+    }
+
+    // Keep the simulated clock at least as far along as the device's was, so
+    // timeouts see the same gaps between inputs
+    if (!started) {
+      traceToSimUs = (int64_t)sim.micros() - r.time;
+      started = true;
+    }
+    int64_t due = (int64_t)r.time + traceToSimUs;
+    if (due > (int64_t)sim.micros()) {
+      sim.advance((uint64_t)(due - sim.micros()) * 1000);
+    }
+    Stats& s = stats[TRACE_TYPE(r.type)];
+    s.events++;
+
+    // What the device saw: time to the next output before the next input
+    for (size_t j = i + 1; j < records.size() && !isInput(records[j].type); j++) {
+      uint8_t type = TRACE_TYPE(records[j].type);
+      if (type == TRACE_CC_OUT || type == TRACE_I2C) {
+        double us = records[j].time - r.time;
+        s.recorded++;
+        s.recordedUsTotal += us;
+        s.recordedUsMax = std::max(s.recordedUsMax, us);
+        break;
+      }
+    }
+
+    if (!applyInput(r)) {
+      fprintf(stderr, "record %zu: no control for cc %d on channel %d\n", i, r.id, TRACE_CHANNEL(r.type));
+      continue;
+    }
+
+    sim.outputs.clear();
+    // Don't run past the point where the device saw its next input, so timeouts
+    // and other deferred work land on the same event they did on stage
+    uint64_t windowNs = UINT64_MAX;
+    for (size_t j = i + 1; j < records.size(); j++) {
+      if (isInput(records[j].type)) {
+        windowNs = (uint64_t)(records[j].time - r.time) * 1000;
+        break;
+      }
+    }
+    if (TRACE_TYPE(r.type) == TRACE_BUTTON && windowNs != UINT64_MAX) {
+      // Button edges are recorded after debouncing; the raw change came earlier
+      windowNs += BUTTON_DEBOUNCE_US * 1000;
+    }
+
+    uint64_t start = sim.nanos;
+    auto hostStart = std::chrono::steady_clock::now();
+    size_t seen = 0;
+    for (int n = 0; n < MAX_LOOPS_PER_EVENT; n++) {
+      loop();
+      if ((seen > 0 && sim.outputs.size() == seen) || sim.nanos - start >= windowNs) {
+        break;
+      }
+      seen = sim.outputs.size();
+    }
+    double hostUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - hostStart).count();
+
+    s.hostUsTotal += hostUs;
+    s.hostUsMax = std::max(s.hostUsMax, hostUs);
+    s.outputs += sim.outputs.size();
+    double latencyUs = -1;
+    if (!sim.outputs.empty()) {
+      latencyUs = sim.outputs.front().time - start / 1000.0;
+      s.withOutput++;
+      s.latencyUsTotal += latencyUs;
+      s.latencyUsMax = std::max(s.latencyUsMax, latencyUs);
+    }
+
+    if (printEvents) {
+      printf("%10u %-7s %2d/%3d %5d  host %8.1f us  outputs %3zu  latency %8.1f us\n",
+             r.time, typeName(r.type), TRACE_CHANNEL(r.type), r.id, r.value, hostUs, sim.outputs.size(), latencyUs);
+    }
+  }
+
+  printf("%-7s %6s %6s %8s %12s %12s %14s %14s %14s %14s\n", "input", "events", "output", "writes",
+         "host avg us", "host max us", "model avg us", "model max us", "device avg us", "device max us");
+  for (auto& it : stats) {
+    const Stats& s = it.second;
+    printf("%-7s %6u %6u %8u %12.1f %12.1f %14.1f %14.1f %14.1f %14.1f\n", typeName(it.first), s.events,
+           s.withOutput, s.outputs, s.hostUsTotal / s.events, s.hostUsMax,
+           s.withOutput ? s.latencyUsTotal / s.withOutput : 0.0, s.latencyUsMax,
+           s.recorded ? s.recordedUsTotal / s.recorded : 0.0, s.recordedUsMax);
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include "sim.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_MCP23017.h>
+#include <Mux.h>
+#include <unistd.h>
+
+Sim sim;
+HostSerial Serial;
+usb_midi_class usbMIDI;
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+Sim::Sim() {
+  memset(digital, HIGH, sizeof(digital));
+  memset(mcpPins, 0xFF, sizeof(mcpPins)); // Buttons are pulled up
+  memset(analog, 0, sizeof(analog));
+  memset(i2cPresent, 0, sizeof(i2cPresent));
+  for (uint8_t addr : {0x24, 0x26, 0x0B, 0x0D}) {
+    i2cPresent[addr] = true;
+  }
+}
+
+// The caller's local is a few bytes above this frame, so freeRam() comes out
+// at sim.freeRam plus a little
+extern "C" __attribute__((noinline)) char* simSbrk(int incr) {
+  return static_cast<char*>(__builtin_frame_address(0)) - sim.freeRam;
+}
+
+void Sim::advanceI2C(uint32_t clock, uint32_t bytes) {
+  // Start + address byte + data bytes, 9 clocks each, + stop
+  nanos += (uint64_t)(bytes + 1) * 9 * 1000000000ull / clock + 1000000000ull / clock;
+  i2cTransactions++;
+}
+
+uint32_t micros() { return sim.micros(); }
+uint32_t millis() { return sim.nanos / 1000000; }
+void delay(uint32_t ms) { sim.advance((uint64_t)ms * 1000000); }
+void delayMicroseconds(uint32_t us) { sim.advance((uint64_t)us * 1000); }
+void pinMode(uint8_t pin, uint8_t mode) {}
+int digitalRead(uint8_t pin) { return sim.digital[pin % SIM_NUM_PINS]; }
+int analogRead(uint8_t pin) {
+  sim.advance(SIM_ANALOG_READ_US * 1000);
+  return sim.analog[pin % SIM_NUM_PINS][sim.muxChannel];
+}
+void analogReadResolution(unsigned int bits) {}
+void analogReadAveraging(unsigned int num) {}
+void noInterrupts() {}
+void interrupts() {}
+
+size_t Print::print(long n, int base) {
+  char buf[40];
+  if (base == HEX) snprintf(buf, sizeof(buf), "%lX", n);
+  else snprintf(buf, sizeof(buf), "%ld", n);
+  return print(buf);
+}
+
+int Print::printf(const char* fmt, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  print(buf);
+  return n;
+}
+
+// Firmware diagnostics go to stderr so they never mix with the report
+size_t HostSerial::write(uint8_t b) { return ::write(2, &b, 1) == 1; }
+size_t HostSerial::write(const uint8_t* buf, size_t len) { return ::write(2, buf, len); }
+int HostSerial::available() { return 0; }
+int HostSerial::read() { return -1; }
+
+void usb_midi_class::sendControlChange(uint8_t control, uint8_t value, uint8_t channel, uint8_t cable) {
+  sim.advance(SIM_USB_MIDI_US * 1000);
+  sim.outputs.push_back({sim.micros(), true, control, value});
+}
+
+void usb_midi_class::sendSysEx(uint32_t length, const uint8_t* data, bool hasTerm, uint8_t cable) {
+  sim.advance(SIM_USB_MIDI_US * 1000 * ((length + 2) / 3));
+  sim.sysexOut.emplace_back(data, data + length);
+}
+
+bool usb_midi_class::read(uint8_t channel) {
+  if (sim.midiIn.empty()) {
+    return false;
+  }
+  std::vector<uint8_t> msg = sim.midiIn.front();
+  sim.midiIn.pop_front();
+  if (msg[0] == 0xF0) {
+    if (sysexHandler) sysexHandler(msg.data(), msg.size());
+  }
+  else if ((msg[0] & 0xF0) == 0xB0 && ccHandler) {
+    ccHandler((msg[0] & 0x0F) + 1, msg[1], msg[2]);
+  }
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= sizeof(txBuffer)) return 0;
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  sim.advanceI2C(clock, txLength);
+  if (!sim.i2cPresent[txAddress & 0x7F] && txAddress != 0) {
+    return 2; // NACK on address
+  }
+  // Expander register pointer writes are part of input polling, not output
+  if ((txAddress & 0x78) != 0x20) {
+    sim.outputs.push_back({sim.micros(), false, txAddress, txLength});
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+  sim.advanceI2C(clock, quantity);
+  rxLength = std::min<uint8_t>(quantity, sizeof(rxBuffer));
+  rxIndex = 0;
+  if ((address & 0x78) == 0x20) {
+    uint16_t pins = sim.mcpPins[address & 7];
+    for (uint8_t i = 0; i < rxLength; i++) {
+      rxBuffer[i] = i % 2 == 0 ? pins & 0xFF : pins >> 8;
+    }
+  }
+  else {
+    memset(rxBuffer, 0, rxLength);
+  }
+  return rxLength;
+}
+
+int TwoWire::available() { return rxLength - rxIndex; }
+int TwoWire::read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+
+uint8_t Adafruit_MCP23017::digitalRead(uint8_t pin) {
+  // Register pointer write, then one byte back (GPIOA or GPIOB)
+  wire->beginTransmission(address);
+  wire->write(pin < 8 ? 0x12 : 0x13);
+  wire->endTransmission();
+  wire->requestFrom(address, 1);
+  return (sim.mcpPins[address & 7] >> pin) & 1;
+}
+
+uint16_t Adafruit_MCP23017::readGPIOAB() {
+  wire->beginTransmission(address);
+  wire->write(0x12);
+  wire->endTransmission();
+  wire->requestFrom(address, 2);
+  return sim.mcpPins[address & 7];
+}
+
+uint8_t Adafruit_MCP23017::readGPIO(uint8_t b) {
+  uint16_t pins = readGPIOAB();
+  return b == 0 ? pins & 0xFF : pins >> 8;
+}
+
+int8_t admux::Mux::channel(int8_t ch) {
+  current = ch;
+  sim.muxChannel = ch;
+  return ch;
+}
@@ -0,0 +1,52 @@
+// Simulated Teensy LC hardware for the replay harness. Time only moves when
+// the firmware waits (delay) or does I/O (I2C, ADC, USB), so the "device"
+// latencies reported by replay are modelled, not host, timings.
+#ifndef _REPLAY_SIM_H_
+#define _REPLAY_SIM_H_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define SIM_NUM_PINS 64
+#define SIM_MUX_CHANNELS 8
+
+// Rough costs of the non-bus operations, in microseconds
+#define SIM_ANALOG_READ_US 12
+#define SIM_USB_MIDI_US 4
+
+struct SimOutput {
+  uint32_t time;
+  bool isCc;        // otherwise an I2C write
+  uint8_t id;       // cc or 7-bit address
+  uint16_t value;   // cc value or byte count
+};
+
+struct Sim {
+  uint64_t nanos = 0;
+  int8_t muxChannel = 0;
+
+  uint8_t digital[SIM_NUM_PINS];
+  // Per MCP23017 (index by address & 7), one bit per pin, 1 = high
+  uint16_t mcpPins[8];
+  uint16_t analog[SIM_NUM_PINS][SIM_MUX_CHANNELS];
+  // 7-bit addresses that acknowledge; the built-in panel's chips by default
+  bool i2cPresent[128];
+
+  std::deque<std::vector<uint8_t>> midiIn;
+  std::vector<SimOutput> outputs;
+  std::vector<std::vector<uint8_t>> sysexOut;
+  uint32_t i2cTransactions = 0;
+  // What freeRam() reports. Host objects are bigger than the LC's, so this only
+  // keeps panel discovery from running out, it doesn't model the LC's RAM.
+  int freeRam = 32768;
+
+  Sim();
+  uint32_t micros() const { return nanos / 1000; }
+  void advance(uint64_t ns) { nanos += ns; }
+  void advanceI2C(uint32_t clock, uint32_t bytes);
+};
+
+extern Sim sim;
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _REPLAY_ADAFRUIT_MCP23017_H_
+#define _REPLAY_ADAFRUIT_MCP23017_H_
+
+#include <Wire.h>
+
+// Pin reads go through the simulated bus so they cost the same wire time as
+// the real library (register write + 1 byte read)
+class Adafruit_MCP23017 {
+  public:
+    void begin(uint8_t addr, TwoWire* theWire = &Wire) { address = 0x20 | addr; wire = theWire; }
+    void begin(TwoWire* theWire = &Wire) { begin(0, theWire); }
+    void pinMode(uint8_t p, uint8_t d) {}
+    void pullUp(uint8_t p, uint8_t d) {}
+    uint8_t digitalRead(uint8_t pin);
+    uint16_t readGPIOAB();
+    uint8_t readGPIO(uint8_t b);
+
+    uint8_t address = 0x20;
+    TwoWire* wire = &Wire;
+};
+
+#endif
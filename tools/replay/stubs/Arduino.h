@@ -0,0 +1,101 @@
+// Minimal host stand-in for the Teensy Arduino core, just enough to build
+// src/main.cpp and lib/ for tools/replay. Hardware is simulated in sim.h.
+#ifndef _REPLAY_ARDUINO_H_
+#define _REPLAY_ARDUINO_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <algorithm>
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define HIGH 1
+#define LOW 0
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A6 20
+#define A7 21
+#define A8 22
+#define A9 23
+
+#define HEX 16
+#define BIN 2
+#define DEC 10
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::min;
+using std::max;
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReadResolution(unsigned int bits);
+void analogReadAveraging(unsigned int num);
+// freeRam() in main.cpp measures from the stack down to sbrk(0); route that to
+// the sim instead of the host's heap
+#include <unistd.h>
+#define sbrk simSbrk
+extern "C" char* simSbrk(int incr);
+void noInterrupts();
+void interrupts();
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+      for (size_t i = 0; i < len; i++) write(buf[i]);
+      return len;
+    }
+    size_t print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    size_t print(long n, int base = DEC);
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+    size_t println(long n, int base = DEC) { return print(n, base) + print("\n"); }
+    int printf(const char* fmt, ...);
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+};
+
+class HostSerial : public Stream {
+  public:
+    void begin(long) {}
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    int available() override;
+    int read() override;
+    int availableForWrite() override { return 64; }
+    explicit operator bool() const { return true; }
+};
+extern HostSerial Serial;
+
+class usb_midi_class {
+  public:
+    void sendControlChange(uint8_t control, uint8_t value, uint8_t channel, uint8_t cable = 0);
+    void sendSysEx(uint32_t length, const uint8_t* data, bool hasTerm = false, uint8_t cable = 0);
+    bool read(uint8_t channel = 0);
+    void setHandleControlChange(void (*fptr)(uint8_t channel, uint8_t control, uint8_t value)) { ccHandler = fptr; }
+    void setHandleSystemExclusive(void (*fptr)(uint8_t* data, unsigned int size)) { sysexHandler = fptr; }
+
+    void (*ccHandler)(uint8_t, uint8_t, uint8_t) = nullptr;
+    void (*sysexHandler)(uint8_t*, unsigned int) = nullptr;
+};
+extern usb_midi_class usbMIDI;
+
+#endif
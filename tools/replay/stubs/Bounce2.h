@@ -0,0 +1,56 @@
+#ifndef _REPLAY_BOUNCE2_H_
+#define _REPLAY_BOUNCE2_H_
+
+#include <Arduino.h>
+
+// Same stable-interval debounce as Bounce2's default mode
+namespace Bounce2 {
+  class Button {
+    public:
+      Button() {}
+      virtual ~Button() {}
+
+      void attach(int pin, int mode) {
+        this->pin = pin;
+        setPinMode(pin, mode);
+        state = readCurrentState();
+        previousMillis = millis();
+      }
+      void interval(uint16_t ms) { intervalMillis = ms; }
+      void setPressedState(bool state) { pressedState = state; }
+
+      bool update() {
+        changed = false;
+        bool current = readCurrentState();
+        if (current != unstable) {
+          unstable = current;
+          previousMillis = millis();
+        }
+        else if (millis() - previousMillis >= intervalMillis && current != state) {
+          state = current;
+          changed = true;
+        }
+        return changed;
+      }
+      bool read() const { return state; }
+      bool isPressed() const { return state == pressedState; }
+      bool pressed() const { return changed && isPressed(); }
+      bool released() const { return changed && !isPressed(); }
+
+    protected:
+      virtual void setPinMode(int pin, int mode) { pinMode(pin, mode); }
+      virtual bool readCurrentState() { return digitalRead(pin); }
+
+      int pin = 0;
+
+    private:
+      bool state = true;
+      bool unstable = true;
+      bool changed = false;
+      bool pressedState = false;
+      uint16_t intervalMillis = 10;
+      uint32_t previousMillis = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,2 @@
+// usbMIDI is declared by Arduino.h, as on the Teensy core
+#include <Arduino.h>
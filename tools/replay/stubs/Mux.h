@@ -0,0 +1,29 @@
+#ifndef _REPLAY_MUX_H_
+#define _REPLAY_MUX_H_
+
+#include <Arduino.h>
+
+namespace admux {
+  enum class PinType { Analog, Digital };
+
+  struct Pin {
+    Pin(uint8_t pin, uint8_t mode, PinType type) : pin(pin) {}
+    uint8_t pin;
+  };
+
+  struct Pinset {
+    Pinset(uint8_t s0, uint8_t s1, uint8_t s2) {}
+  };
+
+  class Mux {
+    public:
+      Mux(Pin signal, Pinset channels) : signal(signal) {}
+      int8_t channel(int8_t ch);
+      int8_t channel() const { return current; }
+
+      Pin signal;
+      int8_t current = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _REPLAY_RESPONSIVE_ANALOG_READ_H_
+#define _REPLAY_RESPONSIVE_ANALOG_READ_H_
+
+#include <Arduino.h>
+
+// Traces record the already-filtered value, so the replay passes readings through
+class ResponsiveAnalogRead {
+  public:
+    ResponsiveAnalogRead(int pin, bool sleepEnable, float snapMultiplier = 0.01) : pin(pin) {}
+    void update() {
+      int next = analogRead(pin);
+      changed = next != value;
+      value = next;
+    }
+    int getValue() const { return value; }
+    int getRawValue() const { return value; }
+    bool hasChanged() const { return changed; }
+    void setAnalogResolution(int resolution) {}
+
+    int pin;
+
+  private:
+    int value = 0;
+    bool changed = false;
+};
+
+#endif
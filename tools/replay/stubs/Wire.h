@@ -0,0 +1,32 @@
+#ifndef _REPLAY_WIRE_H_
+#define _REPLAY_WIRE_H_
+
+#include <Arduino.h>
+
+// Every transaction advances the simulated clock by its time on the wire
+class TwoWire {
+  public:
+    explicit TwoWire(uint8_t bus) : bus(bus) {}
+    void begin() {}
+    void setClock(uint32_t hz) { clock = hz; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    int available();
+    int read();
+
+    uint8_t bus;
+    uint32_t clock = 100000;
+    uint8_t txAddress = 0;
+    uint8_t txBuffer[64];
+    uint8_t txLength = 0;
+    uint8_t rxBuffer[32];
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
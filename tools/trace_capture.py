@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Fetch a trace dump from the controller and save it for tools/replay.
+The firmware must be the teensylc-trace build (see platformio.ini).
+
+Over the USB serial port (needs pyserial):
+    trace_capture.py serial /dev/ttyACM0 trace.bin
+
+From a .syx file recorded while sending F0 7D 01 F7 to the controller (e.g. with
+any SysEx librarian), unpacking the 7-bit SysEx chunks back to the binary dump:
+    trace_capture.py syx dump.syx trace.bin
+"""
+from __future__ import print_function
+import struct
+import sys
+
+SYSEX_MANUFACTURER_ID = 0x7D
+SYSEX_TRACE_DUMP = 0x01
+SYSEX_END_SEQ = 0x7F
+HEADER = struct.Struct('<4sBBH')
+RECORD_SIZE = 8
+
+
+def unpack7(data):
+    """Inverse of sysexPack() in lib/PossumSysEx."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        high_bits = data[i]
+        group = data[i + 1:i + 8]
+        for j, b in enumerate(group):
+            out.append(b | (((high_bits >> j) & 1) << 7))
+        i += 1 + len(group)
+    return bytes(out)
+
+
+def from_syx(raw):
+    dump = bytearray()
+    for msg in raw.split(b'\xf0')[1:]:
+        msg = msg.split(b'\xf7')[0]
+        if len(msg) < 3 or msg[0] != SYSEX_MANUFACTURER_ID or msg[1] != SYSEX_TRACE_DUMP:
+            continue
+        if msg[2] == SYSEX_END_SEQ:
+            break
+        dump += unpack7(bytearray(msg[3:]))
+    return bytes(dump)
+
+
+def from_serial(port):
+    import serial
+    with serial.Serial(port, timeout=2) as s:
+        s.reset_input_buffer()
+        s.write(b'T')
+        header = s.read(HEADER.size)
+        if len(header) < HEADER.size:
+            raise SystemExit('no reply from %s' % port)
+        # Skip anything the firmware printed before the dump
+        start = header.find(b'PTRC')
+        while start < 0:
+            header = header[1:] + s.read(1)
+            start = header.find(b'PTRC')
+        header = header[start:] + s.read(start)
+        count = HEADER.unpack(header)[3]
+        return header + s.read(count * RECORD_SIZE)
+
+
+def main(argv):
+    if len(argv) != 4 or argv[1] not in ('serial', 'syx'):
+        print(__doc__, file=sys.stderr)
+        return 2
+    if argv[1] == 'serial':
+        dump = from_serial(argv[2])
+    else:
+        with open(argv[2], 'rb') as f:
+            dump = from_syx(f.read())
+
+    magic, version, _, count = HEADER.unpack(dump[:HEADER.size])
+    if magic != b'PTRC' or len(dump) < HEADER.size + count * RECORD_SIZE:
+        raise SystemExit('incomplete trace dump')
+    with open(argv[3], 'wb') as f:
+        f.write(dump[:HEADER.size + count * RECORD_SIZE])
+    print('%d records (version %d) -> %s' % (count, version, argv[3]))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))